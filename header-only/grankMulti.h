@@ -2,8 +2,11 @@
 #define GRANKMULTI_H
 
 #include <algorithm>//max
+#include <atomic>
 #include <chrono>
 #include <iostream>
+#include <memory>//unique_ptr
+#include <ostream>
 #include <queue>
 #include <stdlib.h>//exit
 #include <thread>
@@ -12,6 +15,14 @@
 #include <utility>//make pair
 #include <vector>
 
+#ifdef PPR_USE_NUMA
+#include <numa.h>
+#endif
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 using std::cerr; using std::endl;
 using std::make_pair;
 using std::max;
@@ -19,10 +30,209 @@ using std::pair;
 using std::queue;
 using std::swap;
 using std::thread;
+using std::unique_ptr;
 using std::unordered_map;
 using std::unordered_set;
 using std::vector;
 
+//observer of the iterations, same as include/internal/grankObserver.h and under
+//the same include guard, so that this header can be used together with the others
+#ifndef GRANKOBSERVER_H
+#define GRANKOBSERVER_H
+namespace ppr
+{
+  /**
+   * Statistics of an iteration of grank or grankMulti, an iteration recomputes
+   * the maps of the nodes of one of the two partitions.
+   */
+  struct grankIteration
+  {
+    size_t iteration = 0;//index of the iteration, from 0
+    size_t partition = 0;//partition processed, 0 or 1
+    double maxDiff = 0;//max norm-1 between the old and new map of the nodes of the partition
+    size_t nodes = 0;//nodes recomputed
+    size_t merged = 0;//entries of the maps of the successors merged
+    size_t dropped = 0;//entries dropped by keepTop
+    size_t allocations = 0;//maps and map entries allocated
+    double combineSeconds = 0;//time spent combining the maps of the successors
+    double keepTopSeconds = 0;//time spent in keepTop
+    double norm1Seconds = 0;//time spent in norm1
+    double seconds = 0;//wall clock time of the iteration
+  };
+
+  /**
+   * Observer of the iterations of grank and grankMulti, which call iteration()
+   * at the end of each iteration (from the calling thread).
+   */
+  class grankObserver
+  {
+    public:
+      virtual ~grankObserver() {}
+      virtual void iteration(const grankIteration& stats) = 0;
+  };
+
+  /**
+   * Observer writing each iteration to a stream as a line of json, e.g. to
+   * follow the convergence of a long run with "tail -f".
+   */
+  class grankJsonLines: public grankObserver
+  {
+    public:
+      explicit grankJsonLines(std::ostream& out) : out(out) {}
+
+      void iteration(const grankIteration& stats)
+      {
+        out << "{\"iteration\": " << stats.iteration << ", \"partition\": " << stats.partition
+          << ", \"maxDiff\": " << stats.maxDiff << ", \"nodes\": " << stats.nodes << ", \"merged\": " << stats.merged
+          << ", \"dropped\": " << stats.dropped << ", \"allocations\": " << stats.allocations
+          << ", \"combineSeconds\": " << stats.combineSeconds << ", \"keepTopSeconds\": " << stats.keepTopSeconds
+          << ", \"norm1Seconds\": " << stats.norm1Seconds << ", \"seconds\": " << stats.seconds << "}" << std::endl;
+      }
+
+    private:
+      std::ostream& out;
+  };
+
+  namespace pprInternal
+  {
+    /**
+     * Adds the time passed since the previous lap to a counter, doing nothing
+     * (not even reading the clock) when disabled.
+     */
+    class phaseTimer
+    {
+      public:
+        explicit phaseTimer(bool enabled) : enabled(enabled)
+        {
+          if(enabled)
+            last = std::chrono::steady_clock::now();
+        }
+
+        inline void lap(double& seconds)
+        {
+          if(!enabled)
+            return;
+          std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+          seconds += std::chrono::duration<double>(now - last).count();
+          last = now;
+        }
+
+      private:
+        bool enabled;
+        std::chrono::steady_clock::time_point last;
+    };
+
+    /**
+     * Count the work of recomputing the map of a node into the stats of an
+     * iteration: the new map allocates its buckets and an entry for each key it
+     * got before keepTop.
+     * @param stats   Stats of the iteration.
+     * @param merged  Entries of the maps of the successors merged.
+     * @param entries Entries of the new map before keepTop.
+     * @param kept    Entries of the new map after keepTop.
+     */
+    inline void countNode(grankIteration& stats, size_t merged, size_t entries, size_t kept)
+    {
+      stats.nodes++;
+      stats.merged += merged;
+      stats.dropped += entries - kept;
+      stats.allocations += entries + 1;
+    }
+
+    /**
+     * Add the counters and times of the stats of a thread to the ones of the
+     * iteration, keeping the max of the maxDiffs.
+     */
+    inline void addIteration(grankIteration& stats, const grankIteration& thread)
+    {
+      stats.maxDiff = (thread.maxDiff > stats.maxDiff)? thread.maxDiff : stats.maxDiff;
+      stats.nodes += thread.nodes;
+      stats.merged += thread.merged;
+      stats.dropped += thread.dropped;
+      stats.allocations += thread.allocations;
+      stats.combineSeconds += thread.combineSeconds;
+      stats.keepTopSeconds += thread.keepTopSeconds;
+      stats.norm1Seconds += thread.norm1Seconds;
+    }
+  }
+}
+#endif
+
+//cancellation and deadline, same as include/internal/runBudget.h and under the same include guard
+#ifndef RUNBUDGET_H
+#define RUNBUDGET_H
+namespace ppr
+{
+  /**
+   * Cancellation token and wall clock deadline of a run of grank, grankMulti,
+   * mccompletepathv2 or mccompletepathv2Multi. The algorithms check it between
+   * iterations and every few nodes, once it has expired they stop and return
+   * the maps they have so far (their current top-L truncated to K).
+   * cancel() can be called from any thread while the run goes on, the deadline
+   * must be set before the run.
+   */
+  class runBudget
+  {
+    public:
+      runBudget() : cancelled(false), stopped(false), deadline(std::chrono::steady_clock::time_point::max()) {}
+
+      /**
+       * @param seconds Time from now after which the budget expires.
+       */
+      explicit runBudget(double seconds) : runBudget()
+      {
+        setTimeout(seconds);
+      }
+
+      void cancel() { cancelled.store(true, std::memory_order_relaxed); }
+
+      void setDeadline(std::chrono::steady_clock::time_point at) { deadline = at; }
+
+      void setTimeout(double seconds)
+      {
+        deadline = std::chrono::steady_clock::now() +
+          std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds));
+      }
+
+      //true once cancelled or past the deadline
+      bool expired() const
+      {
+        return cancelled.load(std::memory_order_relaxed) || std::chrono::steady_clock::now() >= deadline;
+      }
+
+      //true if a run using the budget stopped before finishing its work
+      bool stoppedEarly() const { return stopped.load(std::memory_order_relaxed); }
+
+      //called by the algorithms when they stop because the budget expired
+      void markStopped() { stopped.store(true, std::memory_order_relaxed); }
+
+    private:
+      std::atomic<bool> cancelled;
+      std::atomic<bool> stopped;
+      std::chrono::steady_clock::time_point deadline;
+  };
+
+  namespace pprInternal
+  {
+    //nodes done between two checks of the budget, reading the clock for every
+    //node would cost more than the work on a node of a sparse graph
+    const size_t budgetCheck = 256;
+
+    /**
+     * True if the budget (if any) expired, checked every budgetCheck calls
+     * counted by "done", marking the budget as stopped.
+     */
+    inline bool budgetExpired(runBudget* budget, size_t done)
+    {
+      if(budget == nullptr || done % budgetCheck != 0 || !budget->expired())
+        return false;
+      budget->markStopped();
+      return true;
+    }
+  }
+}
+#endif
+
 namespace ppr
 {
   /**
@@ -40,6 +250,11 @@ namespace ppr
    * tolerance can be used to have no tolerance at all, making it so that the
    * algorithm stops only once the max number of iterations are done.
    * @param nThreads Number of threads to use (one at least).
+   * @param observer If not nullptr it gets the stats of each iteration (the
+   * times of the phases are only measured when there is an observer, and are
+   * summed over the threads).
+   * @param budget   If not nullptr the run stops once it expires, returning the
+   * maps of the last complete iteration (an iteration in progress is dropped).
    * @return Maps of each node, storing theirs personalized pagerank top-K basket.
    */
   template<typename Key>
@@ -49,8 +264,77 @@ namespace ppr
   size_t iterations,//max number of iterations
   double damping,//damping factor
   double tolerance,//tolerance
+  size_t nThreads,//number of threads, at least 1
+  grankObserver* observer,//observer of the iterations, can be nullptr
+  runBudget* budget);//cancellation and deadline, can be nullptr
+
+  /**
+   * Same as grankMulti above, without a budget.
+   */
+  template<typename Key>
+  unordered_map<Key, unordered_map<Key, double>> grankMulti(const unordered_map<Key, vector<Key>>& graph, //the graph
+  size_t K,//small top, K <= L
+  size_t L,//large top
+  size_t iterations,//max number of iterations
+  double damping,//damping factor
+  double tolerance,//tolerance
+  size_t nThreads,//number of threads, at least 1
+  grankObserver* observer);//observer of the iterations, can be nullptr
+
+  /**
+   * Same as grankMulti above, without an observer nor a budget.
+   */
+  template<typename Key>
+  unordered_map<Key, unordered_map<Key, double>> grankMulti(const unordered_map<Key, vector<Key>>& graph, //the graph
+  size_t K,//small top, K <= L
+  size_t L,//large top
+  size_t iterations,//max number of iterations
+  double damping,//damping factor
+  double tolerance,//tolerance
   size_t nThreads);//number of threads, at least 1
 
+  /**
+   * Placement statistics of a run of grankMultiNuma. Accesses are the reads of
+   * the maps of direct successors done while combining maps, a read is remote if
+   * the map is owned by a thread pinned to another NUMA node.
+   * These are not measured: they are counted from the placement of the nodes on
+   * the threads, assuming each map lives on the NUMA node of its owning thread.
+   */
+  struct numaReport
+  {
+    bool libnuma = false;//true if libnuma was available and used to place threads
+    bool pinned = false;//true if every worker thread has been pinned
+    size_t numaNodes = 0;//number of (possibly simulated) NUMA nodes threads were spread on
+    size_t localAccesses = 0;//reads of maps owned by the same NUMA node
+    size_t remoteAccesses = 0;//reads of maps owned by another NUMA node
+    double remoteRatio = 0;//remoteAccesses / (localAccesses + remoteAccesses), from the placement, not measured
+  };
+
+  /**
+   * NUMA aware version of grankMulti, see grankMulti for the parameters.
+   * Each thread owns a range of nodes of each partition for the whole run, it
+   * is pinned to a NUMA node and it is the one creating (thus allocating on its
+   * own node) the dense score storage of its nodes and their adjacency, resolved
+   * to the owner and slot of each successor so that combining maps never goes
+   * through a shared hash table.
+   * Results are the same of grankMulti.
+   * @param numaNodes Number of NUMA nodes to spread the threads on, 0 to use the
+   * nodes of the machine. A number greater than the actual nodes can be used to
+   * simulate a NUMA machine (threads are still pinned, to cpus picked round robin),
+   * which is also what happens when libnuma is not available.
+   * @param report    If not nullptr it is filled with placement statistics.
+   */
+  template<typename Key>
+  unordered_map<Key, unordered_map<Key, double>> grankMultiNuma(const unordered_map<Key, vector<Key>>& graph, //the graph
+  size_t K,//small top, K <= L
+  size_t L,//large top
+  size_t iterations,//max number of iterations
+  double damping,//damping factor
+  double tolerance,//tolerance
+  size_t nThreads,//number of threads, at least 1
+  size_t numaNodes,//NUMA nodes to spread threads on, 0 for the machine ones
+  numaReport* report);//placement statistics, can be nullptr
+
   /*****************************************************************************
   ******************************************************************************
   ******************************************************************************
@@ -216,6 +500,62 @@ namespace ppr
       return res;
     }
 
+    /**
+     * Combine the maps of the direct successors of a node into its new map.
+     * @param v          Node for which to compute the new map.
+     * @param successors Direct successors of v.
+     * @param scores     Maps of the previous iteration.
+     * @param nextScores Maps of the current iteration, the one of v is replaced.
+     * @param stats      Stats of the iteration for the calling thread, its maxDiff is
+     * updated with the norm-1 between the old and new map of v.
+     * @param L
+     * @param damping
+     * @param timed      True to measure the time of the phases.
+     */
+    template<typename Key>
+    inline void combineNode(const Key& v, const vector<Key>& successors,
+      const unordered_map<Key, unordered_map<Key, double>>& scores,
+      unordered_map<Key, unordered_map<Key, double>>& nextScores,
+      grankIteration& stats, const size_t L, const double damping, const bool timed)
+    {
+      //get nextScores map for current vertex, clear it and obtain results by combining
+      //maps from the successors
+      ppr::pprInternal::phaseTimer timer(timed);
+      unordered_map<Key, double>& next = nextScores.find(v)->second;
+      unordered_map<Key, double> currentMap; currentMap.reserve(next.size());
+      currentMap.insert(make_pair(v, 1.0 - damping));
+
+      double factor = damping / successors.size();
+
+      size_t merged = 0;
+      for(const Key& successor: successors)
+      {
+        /**
+         * for each value of personalized pagerank (max L values) saved
+         * in the map  of a successor increment the personalized pagerank of v
+         * for that key of a fraction of it.
+         */
+         const unordered_map<Key, double>& successorMap = scores.find(successor)->second;
+         for(const auto& keyValue: successorMap)
+           currentMap[keyValue.first] += keyValue.second * factor;
+         merged += successorMap.size();
+      }
+      size_t entries = currentMap.size();
+      timer.lap(stats.combineSeconds);
+
+      //keep the top L values only
+      ppr::grankMultiInternal::keepTop(L, currentMap);
+      timer.lap(stats.keepTopSeconds);
+      ppr::pprInternal::countNode(stats, merged, entries, currentMap.size());
+
+      //check difference between new and old map for this now and eventually
+      //updated the maxDiff
+      stats.maxDiff = max(stats.maxDiff, ppr::grankMultiInternal::norm1(currentMap, scores.find(v)->second));
+      timer.lap(stats.norm1Seconds);
+
+      currentMap.swap(next);
+    }
+
     /**
      * Method used by different threads to combine the node maps.
      * @param begin
@@ -223,48 +563,161 @@ namespace ppr
      * @param graph
      * @param scores
      * @param nextScores
-     * @param maxDiff
+     * @param stats
      * @param L
      * @param damping
+     * @param timed
+     * @param budget     If not nullptr the thread stops once it expires, leaving
+     * stats.nodes lower than the nodes given.
      */
     template<typename Key, typename It>
     inline void combineMaps(It begin, It end, const unordered_map<Key, vector<Key>>& graph,
       const unordered_map<Key, unordered_map<Key, double>>& scores,
       unordered_map<Key, unordered_map<Key, double>>& nextScores,
-      double& maxDiff, const size_t L, const double damping)
+      grankIteration& stats, const size_t L, const double damping, const bool timed, runBudget* budget)
     {
-      //get nextScores map for current vertex, clear it and obtain results by combining
-      //maps from the successors
       for(auto it = begin; it != end; it++)
       {
-        const Key& v = *it;
-        unordered_map<Key, double> currentMap; currentMap.reserve(nextScores[v].size());
-        currentMap.insert(make_pair(v, 1.0 - damping));
+        if(ppr::pprInternal::budgetExpired(budget, stats.nodes))
+          return;
+        combineNode(*it, graph.find(*it)->second, scores, nextScores, stats, L, damping, timed);
+      }
+    }
+
+    /**
+     * Nodes owned by a thread of grankMultiNuma, with their score maps. It is
+     * created and filled by the owning thread, so that its memory is local to
+     * the NUMA node the thread runs on. Nodes are addressed by their slot, the
+     * ones of the first partition come first.
+     */
+    template<typename Key>
+    struct numaOwned
+    {
+      vector<Key> nodes;//owned nodes, indexed by slot
+      size_t split = 0;//slots [0, split) belong to the first partition
+      vector<vector<pair<size_t, size_t>>> successors;//(owner thread, slot) of the successors of each slot
+      vector<unordered_map<Key, double>> maps[2];//score maps, alternating between iterations
+      size_t current[2] = {0, 0};//maps holding the current scores of each partition
+
+      /**
+       * Current score map of a slot.
+       */
+      const unordered_map<Key, double>& scores(size_t slot) const
+      {
+        return maps[current[slot < split? 0 : 1]][slot];
+      }
+    };
+
+    /**
+     * Same as combineNode but for a slot of the nodes owned by the calling thread
+     * (see grankMultiNuma), successor maps are read directly from the slots
+     * of their owners without going through a shared hash table.
+     * @param own    Nodes owned by the calling thread.
+     * @param begin  First slot to combine.
+     * @param end    Slot after the last one to combine.
+     * @param owners Nodes owned by each thread.
+     * @param stats
+     * @param L
+     * @param damping
+     */
+    template<typename Key>
+    inline void combineOwned(numaOwned<Key>& own, size_t begin, size_t end,
+      const vector<unique_ptr<numaOwned<Key>>>& owners,
+      grankIteration& stats, const size_t L, const double damping)
+    {
+      for(size_t slot = begin; slot < end; slot++)
+      {
+        size_t p = slot < own.split? 0 : 1;
+        unordered_map<Key, double>& next = own.maps[1 - own.current[p]][slot];
+        unordered_map<Key, double> currentMap; currentMap.reserve(next.size());
+        currentMap.insert(make_pair(own.nodes[slot], 1.0 - damping));
 
-        //get successors
-        const vector<Key>& successors = graph.find(v)->second;
+        const vector<pair<size_t, size_t>>& successors = own.successors[slot];
         double factor = damping / successors.size();
 
-        for(const Key& successor: successors)
+        size_t merged = 0;
+        for(const pair<size_t, size_t>& successor: successors)
         {
-          /**
-           * for each value of personalized pagerank (max L values) saved
-           * in the map  of a successor increment the personalized pagerank of v
-           * for that key of a fraction of it.
-           */
-           for(const auto& keyValue: scores.find(successor)->second)
-             currentMap[keyValue.first] += keyValue.second * factor;
+          const unordered_map<Key, double>& successorMap = owners[successor.first]->scores(successor.second);
+          for(const auto& keyValue: successorMap)
+            currentMap[keyValue.first] += keyValue.second * factor;
+          merged += successorMap.size();
         }
+        size_t entries = currentMap.size();
 
-        //keep the top L values only
         ppr::grankMultiInternal::keepTop(L, currentMap);
+        ppr::pprInternal::countNode(stats, merged, entries, currentMap.size());
+        stats.maxDiff = max(stats.maxDiff, ppr::grankMultiInternal::norm1(currentMap, own.scores(slot)));
+
+        currentMap.swap(next);
+      }
+    }
+
+    /**
+     * Returns true if libnuma has been compiled in (PPR_USE_NUMA) and is
+     * supported by the running kernel.
+     */
+    inline bool numaAvailable()
+    {
+#ifdef PPR_USE_NUMA
+      return numa_available() >= 0;
+#else
+      return false;
+#endif
+    }
 
-        //check difference between new and old map for this now and eventually
-        //updated the maxDiff
-        maxDiff = max(maxDiff, ppr::grankMultiInternal::norm1(currentMap, scores.find(v)->second));
+    /**
+     * Number of NUMA nodes of the machine, 1 if libnuma is not available.
+     */
+    inline size_t numaNodeCount()
+    {
+#ifdef PPR_USE_NUMA
+      if(numaAvailable())
+        return static_cast<size_t>(numa_max_node()) + 1;
+#endif
+      return 1;
+    }
+
+    /**
+     * Pin the calling thread to the cpus of a NUMA node, memory first touched
+     * by the thread after this call will then be local to the node.
+     * If libnuma is not available or the node does not exist on this machine
+     * (i.e. when simulating more nodes than there are) the thread is pinned
+     * to one of the cpus it is allowed to run on, picked round robin.
+     * @param node   NUMA node on which the thread should run.
+     * @param thread Index of the thread, used for the round robin fallback.
+     * @return True if the thread has been pinned.
+     */
+    inline bool pinThread(size_t node, size_t thread)
+    {
+#ifdef PPR_USE_NUMA
+      if(numaAvailable() && node < numaNodeCount())
+      {
+        numa_set_preferred(static_cast<int>(node));
+        return numa_run_on_node(static_cast<int>(node)) == 0;
+      }
+#endif
+#ifdef __linux__
+      (void) node;
+      cpu_set_t allowed; CPU_ZERO(&allowed);
+      if(sched_getaffinity(0, sizeof(cpu_set_t), &allowed) != 0 || CPU_COUNT(&allowed) == 0)
+        return false;
 
-        currentMap.swap(nextScores[v]);
+      //pick the (thread % allowed cpus)-th allowed cpu
+      size_t target = thread % static_cast<size_t>(CPU_COUNT(&allowed));
+      for(int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+      {
+        if(CPU_ISSET(cpu, &allowed) && target-- == 0)
+        {
+          cpu_set_t set; CPU_ZERO(&set); CPU_SET(cpu, &set);
+          return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &set) == 0;
+        }
       }
+      return false;
+#else
+      (void) node; (void) thread;
+      return false;
+#endif
     }
 
   } //internal namespace for grank multi threaded
@@ -293,7 +746,9 @@ namespace ppr
   size_t iterations,//max number of iterations
   double damping,//damping factor
   double tolerance,//tolerance
-  size_t nThreads)//number of threads, at least 1
+  size_t nThreads,//number of threads, at least 1
+  grankObserver* observer,//observer of the iterations, can be nullptr
+  runBudget* budget)//cancellation and deadline, can be nullptr
   {
     //checking parameters
     if(K == 0){cerr << "K must be positive" << endl; exit(EXIT_FAILURE);}
@@ -373,9 +828,10 @@ namespace ppr
     for(size_t i = 0; i < iterations && max(maxDiff[0], maxDiff[1]) >= tolerance; i++)
     {
       maxDiff[0] = 0;
+      ppr::pprInternal::phaseTimer iterationTimer(observer != nullptr);
 
       //multi threaded combination of direct successors maps for every node
-      vector<double> maxDiffs(nThreads, 0);//used for the maxDiff of every thread
+      vector<grankIteration> threadStats(nThreads);//used for the maxDiff (and stats) of every thread
       size_t chunk = partitionsV.first.size()/nThreads;
       for(size_t t = 0; t < nThreads; t++)
       {
@@ -388,13 +844,20 @@ namespace ppr
         //threads.emplace(function, arguments...)
         threads.emplace_back(ppr::grankMultiInternal::combineMaps<Key, typename vector<Key>::iterator>,
           begin, end, std::ref(graph),
-          std::ref(scores), std::ref(nextScores), std::ref(maxDiffs[t]), L, damping);
+          std::ref(scores), std::ref(nextScores), std::ref(threadStats[t]), L, damping, observer != nullptr, budget);
       }
 
       for(auto& t: threads)
         t.join();
       threads.clear();
 
+      //threads stopped by the budget, scores still has the maps of the previous iteration
+      size_t combined = 0;
+      for(const grankIteration& s: threadStats)
+        combined += s.nodes;
+      if(combined < partitionsV.first.size())
+        break;
+
       //swap partitions
       partitionsV.first.swap(partitionsV.second);
 
@@ -403,12 +866,22 @@ namespace ppr
       for(const Key& v: partitionsV.first)
         nextScores[v].swap(scores[v]);
 
-      for(double m: maxDiffs)
-        maxDiff[0] = max(maxDiff[0], m);
+      grankIteration stats;
+      stats.iteration = i;
+      stats.partition = i % 2;
+      for(const grankIteration& s: threadStats)
+        ppr::pprInternal::addIteration(stats, s);
+      maxDiff[0] = stats.maxDiff;
 
       //swap scores (results from this iteration are the new current results)
       scores.swap(nextScores);
 
+      if(observer != nullptr)
+      {
+        iterationTimer.lap(stats.seconds);
+        observer->iteration(stats);
+      }
+
       //swap diffs
       swap(maxDiff[0], maxDiff[1]);
     }
@@ -435,5 +908,223 @@ namespace ppr
     return scores;
   }
 
+  template<typename Key>
+  unordered_map<Key, unordered_map<Key, double>> grankMulti(const unordered_map<Key, vector<Key>>& graph, //the graph
+  size_t K,//small top, K <= L
+  size_t L,//large top
+  size_t iterations,//max number of iterations
+  double damping,//damping factor
+  double tolerance,//tolerance
+  size_t nThreads,//number of threads, at least 1
+  grankObserver* observer)//observer of the iterations, can be nullptr
+  {
+    return grankMulti(graph, K, L, iterations, damping, tolerance, nThreads, observer, nullptr);
+  }
+
+  template<typename Key>
+  unordered_map<Key, unordered_map<Key, double>> grankMulti(const unordered_map<Key, vector<Key>>& graph, //the graph
+  size_t K,//small top, K <= L
+  size_t L,//large top
+  size_t iterations,//max number of iterations
+  double damping,//damping factor
+  double tolerance,//tolerance
+  size_t nThreads)//number of threads, at least 1
+  {
+    return grankMulti(graph, K, L, iterations, damping, tolerance, nThreads, nullptr, nullptr);
+  }
+
+  template<typename Key>
+  unordered_map<Key, unordered_map<Key, double>> grankMultiNuma(const unordered_map<Key, vector<Key>>& graph, //the graph
+  size_t K,//small top, K <= L
+  size_t L,//large top
+  size_t iterations,//max number of iterations
+  double damping,//damping factor
+  double tolerance,//tolerance
+  size_t nThreads,//number of threads, at least 1
+  size_t numaNodes,//NUMA nodes to spread threads on, 0 for the machine ones
+  numaReport* report)//placement statistics, can be nullptr
+  {
+    //checking parameters
+    if(K == 0){cerr << "K must be positive" << endl; exit(EXIT_FAILURE);}
+    if(L == 0){cerr << "L must be positive" << endl; exit(EXIT_FAILURE);}
+    if(K > L){cerr << "K must be <= L" << endl; exit(EXIT_FAILURE);}
+    if(iterations == 0){cerr << "iterations must be positive" << endl; exit(EXIT_FAILURE);}
+    if(damping < 0 || damping > 1){cerr << "damping must be [0,1]" << endl; exit(EXIT_FAILURE);}
+    if(nThreads == 0){cerr << "nThreads must be positive" << endl; exit(EXIT_FAILURE);}
+
+    if(numaNodes == 0)
+      numaNodes = ppr::grankMultiInternal::numaNodeCount();
+    //a NUMA node without threads would own nothing
+    numaNodes = std::min(numaNodes, nThreads);
+
+    //consecutive threads share the same NUMA node
+    vector<size_t> threadNode(nThreads);
+    for(size_t t = 0; t < nThreads; t++)
+      threadNode[t] = t * numaNodes / nThreads;
+
+    pair<unordered_set<Key>, unordered_set<Key>> partitions = ppr::grankMultiInternal::findPartitions<Key>(graph);
+    vector<Key> partitionsV[2];
+    std::copy(partitions.first.begin(), partitions.first.end(), std::back_inserter(partitionsV[0]));
+    std::copy(partitions.second.begin(), partitions.second.end(), std::back_inserter(partitionsV[1]));
+
+    //range of each partition owned by each thread, chunks are assigned as in grankMulti
+    vector<size_t> first[2];
+    for(size_t p = 0; p < 2; p++)
+    {
+      size_t chunk = partitionsV[p].size()/nThreads;
+      first[p].resize(nThreads + 1);
+      for(size_t t = 0; t < nThreads; t++)
+        first[p][t] = chunk * t;
+      first[p][nThreads] = partitionsV[p].size();
+    }
+
+    //(owner thread, slot) of each graph node, the slots of a thread are its nodes
+    //of the first partition followed by the ones of the second
+    unordered_map<Key, pair<size_t, size_t>> slotOf; slotOf.reserve(graph.size());
+    for(size_t t = 0; t < nThreads; t++)
+    {
+      size_t slot = 0;
+      for(size_t p = 0; p < 2; p++)
+        for(size_t i = first[p][t]; i < first[p][t + 1]; i++)
+          slotOf[partitionsV[p][i]] = make_pair(t, slot++);
+    }
+
+    //nodes owned by each thread, created and filled (and so first touched) by the thread
+    vector<unique_ptr<ppr::grankMultiInternal::numaOwned<Key>>> owners(nThreads);
+    //successor map reads done by thread t at each combination of partition p,
+    //local if the successor is owned by a thread on the same NUMA node
+    vector<size_t> localReads[2];
+    vector<size_t> remoteReads[2];
+    for(size_t p = 0; p < 2; p++)
+    {
+      localReads[p].assign(nThreads, 0);
+      remoteReads[p].assign(nThreads, 0);
+    }
+    vector<char> pinned(nThreads, 0);
+
+    //multi threaded initialization, each thread initializes the nodes it owns
+    vector<thread> threads;
+    for(size_t t = 0; t < nThreads; t++)
+    {
+      threads.emplace_back([&, t]()
+        {
+          pinned[t] = ppr::grankMultiInternal::pinThread(threadNode[t], t);
+          owners[t].reset(new ppr::grankMultiInternal::numaOwned<Key>());
+          ppr::grankMultiInternal::numaOwned<Key>& own = *owners[t];
+
+          for(size_t p = 0; p < 2; p++)
+            own.nodes.insert(own.nodes.end(), partitionsV[p].begin() + first[p][t], partitionsV[p].begin() + first[p][t + 1]);
+          own.split = first[0][t + 1] - first[0][t];
+          own.successors.resize(own.nodes.size());
+          own.maps[0].resize(own.nodes.size());
+          own.maps[1].resize(own.nodes.size());
+
+          for(size_t slot = 0; slot < own.nodes.size(); slot++)
+          {
+            const Key& node = own.nodes[slot];
+            const vector<Key>& successors = graph.find(node)->second;
+            double factor = damping / successors.size();
+            size_t p = slot < own.split? 0 : 1;
+
+            unordered_map<Key, double>& map = own.maps[0][slot];
+            map[node] = 1.0 - damping;
+            own.successors[slot].reserve(successors.size());
+            for(const Key& successor: successors)
+            {
+              map[successor] += factor;
+              const pair<size_t, size_t>& owner = slotOf.find(successor)->second;
+              own.successors[slot].push_back(owner);
+              if(threadNode[owner.first] == threadNode[t])
+                localReads[p][t]++;
+              else
+                remoteReads[p][t]++;
+            }
+
+            ppr::grankMultiInternal::keepTop(L, map);
+          }
+        });
+    }
+    for(auto& t: threads)
+      t.join();
+    threads.clear();
+
+    size_t localAccesses = 0;
+    size_t remoteAccesses = 0;
+
+    //same as grankMulti, see there for the reason of two maxDiffs
+    double maxDiff[2] = {tolerance, tolerance};
+
+    for(size_t i = 0; i < iterations && max(maxDiff[0], maxDiff[1]) >= tolerance; i++)
+    {
+      //partition combined during this iteration
+      size_t p = i % 2;
+      maxDiff[0] = 0;
+
+      vector<grankIteration> threadStats(nThreads);
+      for(size_t t = 0; t < nThreads; t++)
+      {
+        threads.emplace_back([&, t, p]()
+          {
+            ppr::grankMultiInternal::pinThread(threadNode[t], t);
+            ppr::grankMultiInternal::numaOwned<Key>& own = *owners[t];
+            size_t begin = (p == 0)? 0 : own.split;
+            size_t end = (p == 0)? own.split : own.nodes.size();
+            ppr::grankMultiInternal::combineOwned(own, begin, end, owners, threadStats[t], L, damping);
+          });
+      }
+      for(auto& t: threads)
+        t.join();
+      threads.clear();
+
+      for(size_t t = 0; t < nThreads; t++)
+      {
+        localAccesses += localReads[p][t];
+        remoteAccesses += remoteReads[p][t];
+        //results from this iteration are the new current results of the partition,
+        //the other one carries on its maps
+        owners[t]->current[p] = 1 - owners[t]->current[p];
+      }
+
+      for(const grankIteration& s: threadStats)
+        maxDiff[0] = max(maxDiff[0], s.maxDiff);
+
+      //swap diffs
+      swap(maxDiff[0], maxDiff[1]);
+    }
+
+    //keep K top entries for all maps, each thread on its own nodes
+    for(size_t t = 0; t < nThreads; t++)
+    {
+      threads.emplace_back([&, t]()
+        {
+          ppr::grankMultiInternal::pinThread(threadNode[t], t);
+          ppr::grankMultiInternal::numaOwned<Key>& own = *owners[t];
+          for(size_t slot = 0; slot < own.nodes.size(); slot++)
+            ppr::grankMultiInternal::keepTop(K, own.maps[own.current[slot < own.split? 0 : 1]][slot]);
+        });
+    }
+    for(auto& t: threads)
+      t.join();
+
+    if(report != nullptr)
+    {
+      report->libnuma = ppr::grankMultiInternal::numaAvailable();
+      report->pinned = std::find(pinned.begin(), pinned.end(), 0) == pinned.end();
+      report->numaNodes = numaNodes;
+      report->localAccesses = localAccesses;
+      report->remoteAccesses = remoteAccesses;
+      report->remoteRatio = (localAccesses + remoteAccesses == 0)? 0 :
+        static_cast<double>(remoteAccesses) / (localAccesses + remoteAccesses);
+    }
+
+    //moving the maps keeps their entries where the owning threads allocated them
+    unordered_map<Key, unordered_map<Key, double>> scores; scores.reserve(graph.size());
+    for(const auto& own: owners)
+      for(size_t slot = 0; slot < own->nodes.size(); slot++)
+        scores[own->nodes[slot]].swap(own->maps[own->current[slot < own->split? 0 : 1]][slot]);
+
+    return scores;
+  }
+
 } //ppr namespace
 #endif
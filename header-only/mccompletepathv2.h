@@ -48,7 +48,7 @@ namespace ppr
 
 
   /*****************************************************************************
-  The definition of mccompletepathv2 starts at around line 266 in this file, but you should
+  The definition of mccompletepathv2 starts at around line 296 in this file, but you should
   probably read the algorithm from the more readable file "include/mccompletepathv2.h"
   ******************************************************************************
   ******************************************************************************
@@ -68,93 +68,132 @@ namespace ppr
 
   namespace mccompletepathv2Internal
   {
-    std::random_device pprDevice;
-    std::mt19937 pprGenerator(ppr::mccompletepathv2Internal::pprDevice());
-    std::uniform_real_distribution<double> pprDis(0.0, 1.0);
+    /**
+     * Generator used by the random walks, a function local static so that the
+     * header can be included by more than one translation unit.
+     */
+    inline std::mt19937& pprGenerator()
+    {
+      static std::random_device pprDevice;
+      static std::mt19937 generator(pprDevice());
+      return generator;
+    }
 
+    /**
+     * Nodes sorted by decreasing in-degree and then by increasing out-degree,
+     * each followed (breadth first) by the predecessors which are left with no
+     * successor to wait for. Nodes are mapped to dense ids (in the iteration
+     * order of the graph) so that sorting is done with two stable counting
+     * sorts and everything is linear in the size of the graph.
+     */
     template<typename Key>
     vector<Key> executionOrder(const unordered_map<Key, vector<Key>>& graph)
     {
-      //get list of predecessors for each node
-      unordered_map<Key, vector<Key>> predecessors; predecessors.reserve(graph.size());
+      size_t n = graph.size();
+      vector<Key> keys; keys.reserve(n);
+      unordered_map<Key, size_t> ids; ids.reserve(n);
+      vector<size_t> outdegree; outdegree.reserve(n);
       for(const auto& keyVal: graph)
       {
-        const Key& node = keyVal.first;
-        //init predecessors[v] to an empty vector, in case the node has no predecessors
-        predecessors[node];
-        const vector<Key>& successors = keyVal.second;
-
-        for(const Key& v: successors)
-          predecessors[v].push_back(node);
+        ids.insert(make_pair(keyVal.first, keys.size()));
+        keys.push_back(keyVal.first);
+        outdegree.push_back(keyVal.second.size());
       }
 
-      //tuple<node, indegree, outdegree>
-      vector<tuple<Key, size_t, size_t>> data; data.reserve(graph.size());
-      for(const auto& keyVal: graph)
-        data.push_back(std::make_tuple(keyVal.first, predecessors[keyVal.first].size(), keyVal.second.size()));
-
-      std::sort(data.begin(), data.end(),
-        [](const tuple<Key, size_t, size_t>& t1, const tuple<Key, size_t, size_t>& t2)
-        {
-          return (get<1>(t1) > get<1>(t2))? true :
-            (get<1>(t1) == get<1>(t2)? get<2>(t1) < get<2>(t2) : false);
-        });
+      //predecessors of each node, node i has the ones in [start[i], start[i + 1])
+      vector<size_t> start(n + 1, 0);
+      vector<size_t> predecessors;
+      {
+        vector<size_t> targets;
+        for(const auto& keyVal: graph)
+          for(const Key& v: keyVal.second)
+          {
+            targets.push_back(ids.find(v)->second);
+            start[targets.back() + 1]++;
+          }
+        for(size_t i = 0; i < n; i++)
+          start[i + 1] += start[i];
+        predecessors.resize(targets.size());
+        vector<size_t> next(start.begin(), start.end() - 1);
+        size_t e = 0;
+        for(size_t u = 0; u < n; u++)
+          for(size_t i = 0; i < outdegree[u]; i++)
+            predecessors[next[targets[e++]]++] = u;
+      }
 
-      vector<Key> sorted; sorted.reserve(data.size());
-      for(const auto& t: data)
-        sorted.push_back(get<0>(t));
+      //stable counting sort by a key in [0, maxKey]
+      auto countingSort = [](const vector<size_t>& nodes, const vector<size_t>& key, size_t maxKey)
+      {
+        vector<size_t> bucket(maxKey + 2, 0);
+        for(size_t u: nodes)
+          bucket[key[u] + 1]++;
+        for(size_t k = 0; k <= maxKey; k++)
+          bucket[k + 1] += bucket[k];
+        vector<size_t> sorted(nodes.size());
+        for(size_t u: nodes)
+          sorted[bucket[key[u]]++] = u;
+        return sorted;
+      };
+
+      vector<size_t> sorted(n);
+      size_t maxOut = 0, maxIn = 0;
+      for(size_t u = 0; u < n; u++)
+      {
+        sorted[u] = u;
+        maxOut = max(maxOut, outdegree[u]);
+        maxIn = max(maxIn, start[u + 1] - start[u]);
+      }
+      //least significant key first, in-degree is reversed to sort it decreasingly
+      sorted = countingSort(sorted, outdegree, maxOut);
+      vector<size_t> reversedIn(n);
+      for(size_t u = 0; u < n; u++)
+        reversedIn[u] = maxIn - (start[u + 1] - start[u]);
+      sorted = countingSort(sorted, reversedIn, maxIn);
 
       //after sorting the nodes use a heuristic to get a more
-      //efficient order
-      vector<Key> order; order.reserve(data.size());
-      queue<Key> qu;
-
+      //efficient order, the tail of "order" is the queue of the visit
+      vector<size_t> order; order.reserve(n);
       //remaining successors to wait for
-      unordered_map<Key, size_t> waitFor; waitFor.reserve(data.size());
-      for(const auto& keyVal: graph)
-        waitFor[keyVal.first] = keyVal.second.size();
-
+      vector<size_t>& waitFor = outdegree;
       //keep track of visited nodes
-      unordered_set<Key> visited; visited.reserve(data.size());
+      vector<bool> visited(n, false);
 
-      for(const Key& node: sorted)
+      for(size_t node: sorted)
       {
-        if(visited.find(node) == visited.end())
+        if(visited[node])
+          continue;
+        visited[node] = true;
+        order.push_back(node);
+        for(size_t next = order.size() - 1; next < order.size(); next++)
         {
-          qu.push(node);
-          while(!qu.empty())
+          /*
+          for each predecessor decrement the remaining successors to wait
+          for and eventually consider it done when the remaining successors
+          get to 0
+          */
+          for(size_t i = start[order[next]]; i < start[order[next] + 1]; i++)
           {
-            const Key& next = qu.front();
-            order.push_back(next);
-            visited.insert(next);
-            const vector<Key>& nodePredecessors = predecessors[next];
-            qu.pop();
-
-            /*
-            for each predecessor decrement the remaining successors to wait
-            for and eventually consider it done when the remaining successors
-            get to 0
-            */
-            for(const Key& pred: nodePredecessors)
+            size_t pred = predecessors[i];
+            if(waitFor[pred] > 0 && --waitFor[pred] == 0 && !visited[pred])
             {
-              if(waitFor[pred]-- > 0)
-              {
-                //if the node doesn't have to wait for any successor
-                //it could be computed
-                if(!waitFor[pred] && visited.find(pred) == visited.end())
-                  qu.push(pred);
-              }
+              visited[pred] = true;
+              order.push_back(pred);
             }
           }
         }
       }
-      return order;
+
+      vector<Key> res; res.reserve(n);
+      for(size_t u: order)
+        res.push_back(keys[u]);
+      return res;
     }
 
     template<typename Key>
     inline unordered_map<Key, double> walkNode(const unordered_map<Key, vector<Key>>& graph,
       unordered_map<Key, size_t>& index, Key node, const size_t K, double damping, size_t walks)
     {
+      std::uniform_real_distribution<double> pprDis(0.0, 1.0);
       unordered_map<Key, double> res;
       if(graph.find(node)->second.size() > 0)
       {
@@ -191,7 +230,7 @@ namespace ppr
               if(res.find(*currentNode) != res.end() || res.size() < K)
                 res[*currentNode]++;
             }
-          }while(mccompletepathv2Internal::pprDis(mccompletepathv2Internal::pprGenerator) <= damping);
+          }while(pprDis(mccompletepathv2Internal::pprGenerator()) <= damping);
 
         }
         //divide by the number of walks done to obtain the mean
@@ -291,7 +330,7 @@ namespace ppr
       keepTop might remove a small score for "node" and then adding 1 to the node
       will cause the map to have a size of smallTop + 1.
       division by the factor is needed to take into consideration
-      the map multiplication of each value (see around line 248), which averages by outdegree and
+      the map multiplication of each value (see around line 357), which averages by outdegree and
       scales down values using the damping factor; since
       the score for the node itself must not be scaled down the division
       is performed
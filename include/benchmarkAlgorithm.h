@@ -2,16 +2,23 @@
 #define BENCHMARKALGORITHM_H
 
 #include <algorithm>//min
+#include <atomic>
+#include <functional>//hash
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 #include <utility>//make pair
 #include <stdlib.h>//exit
+#include <stdint.h>
 #include <string>
 #include <random>
 #include <iostream>
+#include <thread>
 
+#include <internal/pagerankCache.h>
+#include <internal/pprGraph.h>
 #include <internal/pprInternal.h>
+#include <internal/pprRandom.h>
 #include <internal/pprSingleSource.h>
 #include <internal/kendall.h>
 
@@ -20,10 +27,85 @@ using std::unordered_map;
 using std::unordered_set;
 using std::vector;
 using std::cerr; using std::endl;
+using std::make_pair;
 using std::min;
+using std::pair;
 
 namespace ppr
 {
+  /**
+   * Pagerank of the sample nodes of benchmarkAlgorithm kept in a file, so that
+   * benchmarks run again on the same graph (i.e. while tuning the parameters of
+   * an algorithm) skip computing it. The file is only used for the same graph
+   * (by fingerprint) and the same pagerank parameters, other files are
+   * overwritten; sources missing from the file are computed and added.
+   */
+  struct benchmarkCache
+  {
+    std::string path;//file of the cache
+    //nodes kept of the pagerank of each source, 0 for all of them; the
+    //benchmark only uses the kept nodes, so with the cache results are the
+    //same as with no cache only if topN is 0
+    size_t topN = 0;
+  };
+
+  namespace pprInternal
+  {
+    //jaccard, kendall and basket size of a sample node
+    struct sampleStats
+    {
+      double jaccard;
+      double kendall;
+      double mapSize;
+    };
+
+    /**
+     * Confront the basket of a sample node with its pagerank.
+     * @param otherAlgo Basket of the node given by the benchmarked algorithm.
+     * @param pagerank  Pagerank of the node, modified.
+     */
+    template<typename Key>
+    sampleStats evaluateSample(const unordered_map<Key, double>& otherAlgo, unordered_map<Key, double>& pagerank)
+    {
+      sampleStats stats;
+      //needed for kendall
+      unordered_map<Key, double> bkup(pagerank);
+      //have the top-K be the same of the size of the top-K from the approximation algorithm, needed for jaccard
+      keepTop<Key>(otherAlgo.size(), pagerank);
+
+      //jaccard stuff
+      //create sets
+      unordered_set<Key> setOther;
+      setOther.reserve(otherAlgo.size());
+      unordered_set<Key> setPagerank;
+      setPagerank.reserve(otherAlgo.size());
+      for(const auto& keyVal: otherAlgo)
+        setOther.insert(keyVal.first);
+      for(const auto& keyVal: pagerank)
+        setPagerank.insert(keyVal.first);
+
+      stats.jaccard = jaccard<Key>(setOther, setPagerank);
+
+      //kendall stuff
+      //push pairs of scores (seen as two vectors) of the nodes of the top-K of
+      //the benchmarked algorithm, a pair is formed by the score given by
+      //the benchmarked algorithm and by classic pagerank
+      vector<double> otherScores;
+      otherScores.reserve(otherAlgo.size());
+      vector<double> pagerankScores;
+      pagerankScores.reserve(otherAlgo.size());
+      for(const auto& keyVal: otherAlgo)
+      {
+        otherScores.push_back(keyVal.second);
+        pagerankScores.push_back(bkup[keyVal.first]);
+      }
+
+      stats.kendall = kendallCorrelation(otherScores, pagerankScores);
+      stats.mapSize = otherAlgo.size();
+      return stats;
+    }
+  }
+
   /**
    * Given a map mapping source nodes to a basket containing top-K personalized
    * Pagerank scores confront the provided results with those provided by
@@ -37,6 +119,13 @@ namespace ppr
    * @param strict    If true nodes with outdegree equal 0 will be skipped while
    * randomly picking sample nodes. This is to avoid having those nodes inflating
    * the jaccard and kendall values.
+   * @param nThreads  Number of threads to use (one at least). Sample nodes are
+   * split among the threads in batches (see pprMultiSource), the statistics of
+   * each sample have their own slot and are summed up in the order of the
+   * samples at the end, so the results don't depend on the number of threads.
+   * @param seed      Seed of the sampling, runs with the same seed (and the same
+   * maps) benchmark the same sample nodes.
+   * @param cache     File of the pagerank of the sample nodes (see benchmarkCache), can be nullptr.
    * @return Returns a map mapping names of statistics to their value: the jaccard
    * average and min, the kendall average and min, the average size of maps from
    * the "ppr" parameter. This last statistic might be useful because while experimenting
@@ -50,15 +139,19 @@ namespace ppr
    */
   template<typename Key>
   unordered_map<string, double> benchmarkAlgorithm(const unordered_map<Key, unordered_map<Key, double>>& ppr,
-    const unordered_map<Key, vector<Key>>& graph, size_t testNodes, bool strict)
+    const unordered_map<Key, vector<Key>>& graph, size_t testNodes, bool strict, size_t nThreads, uint64_t seed,
+    const benchmarkCache* cache)
   {
     if(testNodes == 0) {cerr << "testNodes must be positive" << endl; exit(EXIT_FAILURE);}
+    if(nThreads == 0) {cerr << "nThreads must be positive" << endl; exit(EXIT_FAILURE);}
+    if(cache != nullptr && cache->path.empty()) {cerr << "cache path must not be empty" << endl; exit(EXIT_FAILURE);}
     unordered_map<string, double> result;
+    const size_t iterations = 100;
+    const double damping = 0.85;
+    const double tolerance = 0.0001;
 
     // shuffle nodes to benchmark the algorithm on a number of random nodes equal to
     // testNodes parameter
-    std::random_device rd;
-    std::mt19937 g(rd());
     vector<Key> nodes;
     for(const auto& keyVal: ppr)
     {
@@ -76,65 +169,112 @@ namespace ppr
       else
           nodes.push_back(keyVal.first);
     }
-    shuffle(nodes.begin(), nodes.end(), g);
+    //the order of the map depends on how it was built, the one of the hashes
+    //(mostly) doesn't, so that the same seed gives the same sample
+    std::hash<Key> hasher;
+    std::stable_sort(nodes.begin(), nodes.end(), [&hasher](const Key& u, const Key& v)
+      { return hasher(u) < hasher(v);});
+    pprInternal::xoshiro256 generator(seed);
+    shuffle(nodes.begin(), nodes.end(), generator);
+    nodes.resize(min(nodes.size(), testNodes));
 
-    double jaccardAverage = 0;
-    double jaccardMin = 1.0;
-    double kendallAverage = 0;
-    double kendallMin = 1.0;
-    double averageMapSize = 0;
-    for(size_t i = 0, iEnd = min(nodes.size(), testNodes); i < iEnd; i++)
+    //pagerank of the sample nodes, computed in batches over a dense copy of the graph
+    pprInternal::denseGraph<Key> dense = pprInternal::makeDenseGraph(graph);
+    vector<size_t> sampleIds;
+    sampleIds.reserve(nodes.size());
+    for(const Key& node: nodes)
+      sampleIds.push_back(dense.ids.find(node)->second);
+
+    pprInternal::pagerankCache cached;
+    if(cache != nullptr && !cached.load(cache->path, pprInternal::fingerprint(dense), dense.size(), iterations,
+      damping, tolerance, cache->topN))
+    {
+      cached.graph = pprInternal::fingerprint(dense);
+      cached.n = dense.size();
+      cached.iterations = iterations;
+      cached.damping = damping;
+      cached.tolerance = tolerance;
+      cached.topN = cache->topN;
+    }
+    //pagerank computed for the samples which are not in the cache, to add to it
+    vector<vector<pair<size_t, double>>> computed(nodes.size());
+    vector<char> isComputed(nodes.size(), 0);
+
+    //each batch of samples is taken by a thread, which fills the slots of its samples
+    vector<pprInternal::sampleStats> stats(nodes.size());
+    std::atomic<size_t> nextBatch(0);
+    auto worker = [&]()
+    {
+      for(size_t first = (nextBatch++) * pprInternal::batchSize; first < nodes.size();
+        first = (nextBatch++) * pprInternal::batchSize)
       {
-        const Key& node = nodes[i];
-        const unordered_map<Key, double>& otherAlgo = ppr.find(node)->second;
-
-        unordered_map<Key, double> pagerank = pprInternal::pprSingleSource<Key>(graph, 100, 0.85, 0.0001, node);
-        //needed for kendall
-        unordered_map<Key, double> bkup(pagerank);
-        //have the top-K be the same of the size of the top-K from the approximation algorithm, needed for jaccard
-        pprInternal::keepTop<Key>(otherAlgo.size(), pagerank);
-
-        //jaccard stuff
-        //create sets
-        unordered_set<Key> setOther;
-        setOther.reserve(otherAlgo.size());
-        unordered_set<Key> setPagerank;
-        setPagerank.reserve(otherAlgo.size());
-        for(const auto& keyVal: otherAlgo)
-          setOther.insert(keyVal.first);
-        for(const auto& keyVal: pagerank)
-          setPagerank.insert(keyVal.first);
-
-        double jaccard = pprInternal::jaccard<Key>(setOther, setPagerank);
-        jaccardAverage += jaccard;
-        jaccardMin = std::min(jaccardMin, jaccard);
-
-        //kendall stuff
-        //push pairs of scores (seen as two vectors) of the nodes of the top-K of
-        //the benchmarked algorithm, a pair is formed by the score given by
-        //the benchmarked algorithm and by classic pagerank
-        vector<double> otherScores;
-        otherScores.reserve(otherAlgo.size());
-        vector<double> pagerankScores;
-        pagerankScores.reserve(otherAlgo.size());
-        for(const auto& keyVal: otherAlgo)
+        size_t last = min(nodes.size(), first + pprInternal::batchSize);
+        vector<size_t> batch;
+        for(size_t i = first; i < last; i++)
+          if(cache == nullptr || cached.scores.find(sampleIds[i]) == cached.scores.end())
+            batch.push_back(sampleIds[i]);
+        vector<unordered_map<Key, double>> pageranks;
+        if(!batch.empty())
+          pageranks = pprInternal::pprMultiSource(dense, batch, iterations, damping, tolerance);
+
+        for(size_t i = first, b = 0; i < last; i++)
         {
-          otherScores.push_back(keyVal.second);
-          pagerankScores.push_back(bkup[keyVal.first]);
+          unordered_map<Key, double> pagerank;
+          auto it = (cache == nullptr)? cached.scores.end() : cached.scores.find(sampleIds[i]);
+          if(it != cached.scores.end())
+            for(const auto& score: it->second)
+              pagerank.insert(make_pair(dense.keys[score.first], score.second));
+          else
+          {
+            pagerank.swap(pageranks[b++]);
+            if(cache != nullptr)
+            {
+              if(cache->topN > 0)
+                pprInternal::keepTop(cache->topN, pagerank);
+              for(const auto& keyVal: pagerank)
+                computed[i].push_back(make_pair(dense.ids.find(keyVal.first)->second, keyVal.second));
+              isComputed[i] = 1;
+            }
+          }
+          stats[i] = pprInternal::evaluateSample(ppr.find(nodes[i])->second, pagerank);
         }
+      }
+    };
+    vector<std::thread> threads;
+    for(size_t t = 1; t < nThreads; t++)
+      threads.emplace_back(worker);
+    worker();
+    for(auto& t: threads)
+      t.join();
 
-        double kendall = kendallCorrelation(otherScores, pagerankScores);
-        kendallAverage += kendall;
-        kendallMin = std::min(kendallMin, kendall);
+    if(cache != nullptr && std::find(isComputed.begin(), isComputed.end(), 1) != isComputed.end())
+    {
+      for(size_t i = 0; i < nodes.size(); i++)
+        if(isComputed[i])
+          cached.scores[sampleIds[i]].swap(computed[i]);
+      if(!cached.save(cache->path))
+        cerr << "could not save the benchmark cache to " << cache->path << endl;
+    }
 
-        averageMapSize += otherAlgo.size();
-      }
+    double jaccardAverage = 0;
+    double jaccardMin = 1.0;
+    double kendallAverage = 0;
+    double kendallMin = 1.0;
+    double averageMapSize = 0;
+    for(const pprInternal::sampleStats& sample: stats)
+    {
+      jaccardAverage += sample.jaccard;
+      jaccardMin = std::min(jaccardMin, sample.jaccard);
+      kendallAverage += sample.kendall;
+      kendallMin = std::min(kendallMin, sample.kendall);
+      averageMapSize += sample.mapSize;
+    }
 
-    if(min(nodes.size(), testNodes))
+    if(nodes.size())
     {
-      jaccardAverage /= std::min(nodes.size(), testNodes);
-      kendallAverage /= std::min(nodes.size(), testNodes);
-      averageMapSize /= std::min(nodes.size(), testNodes);
+      jaccardAverage /= nodes.size();
+      kendallAverage /= nodes.size();
+      averageMapSize /= nodes.size();
       result["jaccard average"] = jaccardAverage;
       result["jaccard min"] = jaccardMin;
       result["kendall average"] = kendallAverage;
@@ -151,5 +291,25 @@ namespace ppr
     }
     return result;
   }
+
+  /**
+   * Same as above, with a non deterministic seed and no cache.
+   */
+  template<typename Key>
+  unordered_map<string, double> benchmarkAlgorithm(const unordered_map<Key, unordered_map<Key, double>>& ppr,
+    const unordered_map<Key, vector<Key>>& graph, size_t testNodes, bool strict, size_t nThreads)
+  {
+    return benchmarkAlgorithm(ppr, graph, testNodes, strict, nThreads, pprInternal::randomSeed(), nullptr);
+  }
+
+  /**
+   * Single threaded benchmarkAlgorithm, see above.
+   */
+  template<typename Key>
+  unordered_map<string, double> benchmarkAlgorithm(const unordered_map<Key, unordered_map<Key, double>>& ppr,
+    const unordered_map<Key, vector<Key>>& graph, size_t testNodes, bool strict)
+  {
+    return benchmarkAlgorithm(ppr, graph, testNodes, strict, 1);
+  }
 }
 #endif
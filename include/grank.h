@@ -7,7 +7,10 @@
 #include <utility>//make pair
 #include <vector>
 
+#include <internal/grankObserver.h>
+#include <internal/memoryAccounting.h>
 #include <internal/pprInternal.h>
+#include <internal/runBudget.h>
 
 using std::cerr; using std::endl;
 using std::make_pair;
@@ -17,9 +20,13 @@ using std::unordered_map;
 using std::unordered_set;
 using std::vector;
 
+using ppr::pprInternal::budgetExpired;
+using ppr::pprInternal::combineSuccessors;
+using ppr::pprInternal::countNode;
 using ppr::pprInternal::findPartitions;
 using ppr::pprInternal::keepTop;
 using ppr::pprInternal::norm1;
+using ppr::pprInternal::phaseTimer;
 
 namespace ppr
 {
@@ -37,6 +44,10 @@ namespace ppr
    * @param tolerance  Stopping tolerance based on the norm-1 between old and new top-L, a negative
    * tolerance can be used to have no tolerance at all, making it so that the
    * algorithm stops only once the max number of iterations are done.
+   * @param observer   If not nullptr it gets the stats of each iteration (the
+   * times of the phases are only measured when there is an observer).
+   * @param budget     If not nullptr the run stops once it expires, returning the
+   * maps of the last complete iteration (an iteration in progress is dropped).
    * @return Maps of each node, storing theirs personalized pagerank top-K basket.
    */
   template<typename Key>
@@ -45,7 +56,9 @@ namespace ppr
   size_t L,//large top
   size_t iterations,//max number of iterations
   double damping,//damping factor
-  double tolerance)//tolerance
+  double tolerance,//tolerance
+  grankObserver* observer,//observer of the iterations, can be nullptr
+  runBudget* budget)//cancellation and deadline, can be nullptr
   {
     //checking parameters
     if(K == 0){cerr << "K must be positive" << endl; exit(EXIT_FAILURE);}
@@ -56,6 +69,9 @@ namespace ppr
     //note: no checks on tolerance to allow having no tolerance at all by setting
     //it to a negative number
 
+    memoryPhase phase("grank");
+    memoryScope scope(memoryScores);
+
     //allocate scores maps
     unordered_map<Key, unordered_map<Key, double>> scores; scores.reserve(graph.size());
     unordered_map<Key, unordered_map<Key, double>> nextScores; nextScores.reserve(graph.size());
@@ -82,7 +98,9 @@ namespace ppr
       keepTop(L, scores[v]);
     }
 
+    scope.set(memoryScratch);
     pair<unordered_set<Key>, unordered_set<Key>> partitions = findPartitions<Key>(graph);
+    scope.set(memoryScores);
     //max difference between old and new map between iterations, a variable for each
     //partition is needed to avoid some edge cases where a very simple partitition (i.e. no edges etc.)
     //might make the algorithm converge during the first iteration, before the
@@ -92,11 +110,23 @@ namespace ppr
     for(size_t i = 0; i < iterations && max(maxDiff[0], maxDiff[1]) >= tolerance; i++)
     {
       maxDiff[0] = 0;
+      grankIteration stats;
+      stats.iteration = i;
+      stats.partition = i % 2;
+      phaseTimer iterationTimer(observer != nullptr);
 
+      bool stopped = false;
       for(const Key& v: partitions.first)
       {
+        if(budgetExpired(budget, stats.nodes))
+        {
+          stopped = true;
+          break;
+        }
+
         //get nextScores map for current vertex, clear it and obtain results by combining
         //maps from the successors
+        phaseTimer timer(observer != nullptr);
         unordered_map<Key, double> currentMap; currentMap.reserve(nextScores[v].size());
         currentMap.insert(make_pair(v, 1.0 - damping));
 
@@ -104,26 +134,25 @@ namespace ppr
         const vector<Key>& successors = graph.find(v)->second;
         double factor = damping / successors.size();
 
-        for(const Key& successor: successors)
-        {
-          /**
-           * for each value of personalized pagerank (max L values) saved
-           * in the map  of a successor increment the personalized pagerank of v
-           * for that key of a fraction of it.
-           */
-           for(const auto& keyValue: scores[successor])
-             currentMap[keyValue.first] += keyValue.second * factor;
-        }
+        size_t merged = combineSuccessors(scores, successors, factor, currentMap);
+        size_t entries = currentMap.size();
+        timer.lap(stats.combineSeconds);
 
         //keep the top L values only
         keepTop(L, currentMap);
+        timer.lap(stats.keepTopSeconds);
+        countNode(stats, merged, entries, currentMap.size());
 
         //check difference between new and old map for this now and eventually
         //updated the maxDiff
         maxDiff[0] = max(maxDiff[0], norm1(currentMap, scores[v]));
+        timer.lap(stats.norm1Seconds);
 
         currentMap.swap(nextScores[v]);
       }
+      //scores still has the maps of the previous iteration
+      if(stopped)
+        break;
 
       //swap partitions
       partitions.first.swap(partitions.second);
@@ -136,6 +165,13 @@ namespace ppr
       //swap scores (results from this iteration are the new current results)
       scores.swap(nextScores);
 
+      if(observer != nullptr)
+      {
+        stats.maxDiff = maxDiff[0];
+        iterationTimer.lap(stats.seconds);
+        observer->iteration(stats);
+      }
+
       //swap diffs
       swap(maxDiff[0], maxDiff[1]);
     }
@@ -148,6 +184,35 @@ namespace ppr
 
     return scores;
   }
+
+  /**
+   * Same as grank above, without a budget.
+   */
+  template<typename Key>
+  unordered_map<Key, unordered_map<Key, double>> grank(const unordered_map<Key, vector<Key>>& graph, //the graph
+  size_t K,//small top, K <= L
+  size_t L,//large top
+  size_t iterations,//max number of iterations
+  double damping,//damping factor
+  double tolerance,//tolerance
+  grankObserver* observer)//observer of the iterations, can be nullptr
+  {
+    return grank(graph, K, L, iterations, damping, tolerance, observer, nullptr);
+  }
+
+  /**
+   * Same as grank above, without an observer nor a budget.
+   */
+  template<typename Key>
+  unordered_map<Key, unordered_map<Key, double>> grank(const unordered_map<Key, vector<Key>>& graph, //the graph
+  size_t K,//small top, K <= L
+  size_t L,//large top
+  size_t iterations,//max number of iterations
+  double damping,//damping factor
+  double tolerance)//tolerance
+  {
+    return grank(graph, K, L, iterations, damping, tolerance, nullptr, nullptr);
+  }
 }
 
 #endif
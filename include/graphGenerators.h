@@ -0,0 +1,279 @@
+#ifndef GRAPHGENERATORS_H
+#define GRAPHGENERATORS_H
+
+#include <algorithm>//max
+#include <atomic>
+#include <cmath>//log
+#include <iostream>
+#include <stdint.h>
+#include <stdlib.h>//exit
+#include <thread>
+#include <unordered_map>
+#include <utility>//pair
+#include <vector>
+
+#include <internal/pprRandom.h>
+
+using std::cerr; using std::endl;
+using std::pair;
+using std::unordered_map;
+using std::vector;
+
+using ppr::pprInternal::deriveSeed;
+using ppr::pprInternal::xoshiro256;
+
+namespace ppr
+{
+  namespace pprInternal
+  {
+    //nodes (or edges, for rmat) generated by each task of a generator
+    const size_t generatorChunk = 1 << 14;
+
+    /**
+     * Run the tasks of a generator on nThreads threads and build the graph.
+     * Task i gets its own generator, seeded with deriveSeed(seed, i), and fills
+     * its own list of edges; edges are added to the graph in task order, so the
+     * graph only depends on the seed and not on the number of threads.
+     * @param n        Nodes of the graph, ids are [0, n).
+     * @param tasks    Number of tasks.
+     * @param seed
+     * @param nThreads Number of threads to use (one at least).
+     * @param task     task(i, generator, edges), appends the edges of task i.
+     */
+    template<typename Key, typename Task>
+    unordered_map<Key, vector<Key>> generateGraph(size_t n, size_t tasks, uint64_t seed, size_t nThreads, Task task)
+    {
+      vector<vector<pair<size_t, size_t>>> edges(tasks);
+      std::atomic<size_t> next(0);
+      auto worker = [&]()
+      {
+        for(size_t i = next++; i < tasks; i = next++)
+        {
+          xoshiro256 generator(deriveSeed(seed, i));
+          task(i, generator, edges[i]);
+        }
+      };
+      vector<std::thread> threads;
+      for(size_t t = 1; t < nThreads; t++)
+        threads.emplace_back(worker);
+      worker();
+      for(auto& t: threads)
+        t.join();
+
+      unordered_map<Key, vector<Key>> graph;
+      graph.reserve(n);
+      //every node is a key, also the ones without successors
+      for(size_t u = 0; u < n; u++)
+        graph[static_cast<Key>(u)];
+      for(vector<pair<size_t, size_t>>& taskEdges: edges)
+      {
+        for(const auto& edge: taskEdges)
+          graph[static_cast<Key>(edge.first)].push_back(static_cast<Key>(edge.second));
+        vector<pair<size_t, size_t>>().swap(taskEdges);
+      }
+      return graph;
+    }
+  }
+
+  /**
+   * R-MAT graph (Chakrabarti, Zhan, Faloutsos), the Kronecker-like generator
+   * of Graph500: 2^scale nodes, each edge falls in one of the four quadrants of
+   * the adjacency matrix with probabilities a, b, c and 1 - a - b - c, and so
+   * on recursively, giving skewed degrees and communities. Edges may be
+   * repeated and may be self loops, as in Graph500.
+   * Graphs built by the generators have ids [0, n) as nodes (converted to Key)
+   * and only depend on the seed, not on the number of threads.
+   * @param scale    Log2 of the number of nodes.
+   * @param edges    Number of edges.
+   * @param a        Probability of the top left quadrant (Graph500 uses 0.57).
+   * @param b        Probability of the top right quadrant (0.19).
+   * @param c        Probability of the bottom left quadrant (0.19).
+   * @param seed
+   * @param nThreads Number of threads to use (one at least).
+   */
+  template<typename Key>
+  unordered_map<Key, vector<Key>> rmatGraph(size_t scale, //log2 of the nodes
+    size_t edges,//number of edges
+    double a,//top left quadrant probability
+    double b,//top right quadrant probability
+    double c,//bottom left quadrant probability
+    uint64_t seed,//seed of the generator
+    size_t nThreads)//number of threads, at least 1
+  {
+    if(scale >= 8 * sizeof(size_t) - 1){cerr << "scale is too large" << endl; exit(EXIT_FAILURE);}
+    if(a < 0 || b < 0 || c < 0 || a + b + c > 1){cerr << "a, b, c must be probabilities with a sum <= 1" << endl; exit(EXIT_FAILURE);}
+    if(nThreads == 0){cerr << "nThreads must be positive" << endl; exit(EXIT_FAILURE);}
+
+    size_t tasks = (edges + pprInternal::generatorChunk - 1) / pprInternal::generatorChunk;
+    return pprInternal::generateGraph<Key>(size_t(1) << scale, tasks, seed, nThreads,
+      [=](size_t task, xoshiro256& generator, vector<pair<size_t, size_t>>& taskEdges)
+      {
+        size_t first = task * pprInternal::generatorChunk;
+        size_t last = std::min(edges, first + pprInternal::generatorChunk);
+        taskEdges.reserve(last - first);
+        for(size_t e = first; e < last; e++)
+        {
+          size_t u = 0, v = 0;
+          for(size_t bit = 0; bit < scale; bit++)
+          {
+            double r = generator.nextDouble();
+            size_t row = (r >= a + b);
+            size_t column = (r >= a && r < a + b) || r >= a + b + c;
+            u = (u << 1) | row;
+            v = (v << 1) | column;
+          }
+          taskEdges.push_back(std::make_pair(u, v));
+        }
+      });
+  }
+
+  /**
+   * Directed Erdos-Renyi graph G(n, p), with p = averageDegree / n: every
+   * edge u -> v (self loops included) is there with probability p, independently.
+   * Successors are drawn by skipping ahead geometrically, so the work is
+   * proportional to the edges and not to n^2.
+   * @param n             Number of nodes.
+   * @param averageDegree Expected outdegree of each node.
+   * @param seed
+   * @param nThreads      Number of threads to use (one at least).
+   */
+  template<typename Key>
+  unordered_map<Key, vector<Key>> erdosRenyiGraph(size_t n, //number of nodes
+    double averageDegree,//expected outdegree
+    uint64_t seed,//seed of the generator
+    size_t nThreads)//number of threads, at least 1
+  {
+    if(averageDegree < 0 || averageDegree > n){cerr << "averageDegree must be [0,n]" << endl; exit(EXIT_FAILURE);}
+    if(nThreads == 0){cerr << "nThreads must be positive" << endl; exit(EXIT_FAILURE);}
+
+    double p = (n > 0)? averageDegree / n : 0;
+    double logMiss = std::log(1.0 - p);
+    size_t tasks = (n + pprInternal::generatorChunk - 1) / pprInternal::generatorChunk;
+    return pprInternal::generateGraph<Key>(n, tasks, seed, nThreads,
+      [=](size_t task, xoshiro256& generator, vector<pair<size_t, size_t>>& taskEdges)
+      {
+        for(size_t u = task * pprInternal::generatorChunk, uEnd = std::min(n, u + pprInternal::generatorChunk);
+          u < uEnd && p > 0; u++)
+          for(size_t v = 0; ; v++)
+          {
+            //number of nodes skipped before the next successor, geometric
+            if(p < 1)
+            {
+              double skip = std::log(1.0 - generator.nextDouble()) / logMiss;
+              if(skip >= n - v)
+                break;
+              v += static_cast<size_t>(skip);
+            }
+            if(v >= n)
+              break;
+            taskEdges.push_back(std::make_pair(u, v));
+          }
+      });
+  }
+
+  /**
+   * Barabasi-Albert graph: node u > 0 links to edgesPerNode older nodes,
+   * picked with probability proportional to their degree (node 0 links to
+   * itself). Edge j of the graph is the pair of positions 2j (its source) and
+   * 2j + 1 (its target) of the list of all the edges, and its target is the
+   * node at a random position before 2j + 1 of that list, which is found
+   * following targets back until a source is hit (Sanders, Schulz, "Scalable
+   * generation of scale-free graphs"); the random position only depends on
+   * the seed and on j, so the edges can be generated in any order, in parallel.
+   * Edges may be repeated.
+   * @param n            Number of nodes.
+   * @param edgesPerNode Outdegree of each node.
+   * @param seed
+   * @param nThreads     Number of threads to use (one at least).
+   */
+  template<typename Key>
+  unordered_map<Key, vector<Key>> barabasiAlbertGraph(size_t n, //number of nodes
+    size_t edgesPerNode,//outdegree of each node
+    uint64_t seed,//seed of the generator
+    size_t nThreads)//number of threads, at least 1
+  {
+    if(edgesPerNode == 0){cerr << "edgesPerNode must be positive" << endl; exit(EXIT_FAILURE);}
+    if(nThreads == 0){cerr << "nThreads must be positive" << endl; exit(EXIT_FAILURE);}
+
+    size_t tasks = (n + pprInternal::generatorChunk - 1) / pprInternal::generatorChunk;
+    return pprInternal::generateGraph<Key>(n, tasks, seed, nThreads,
+      [=](size_t task, xoshiro256&, vector<pair<size_t, size_t>>& taskEdges)
+      {
+        size_t first = task * pprInternal::generatorChunk;
+        size_t last = std::min(n, first + pprInternal::generatorChunk);
+        taskEdges.reserve((last - first) * edgesPerNode);
+        for(size_t e = first * edgesPerNode; e < last * edgesPerNode; e++)
+        {
+          size_t position = 2 * e + 1;
+          //odd positions are targets, even ones sources
+          while(position % 2 == 1)
+            position = deriveSeed(seed, position) % position;
+          taskEdges.push_back(std::make_pair(e / edgesPerNode, position / 2 / edgesPerNode));
+        }
+      });
+  }
+
+  /**
+   * Grid graph of rows x columns nodes, node r * columns + c has an edge to each
+   * of its (up to four) neighbours, in both directions.
+   * @param rows
+   * @param columns
+   */
+  template<typename Key>
+  unordered_map<Key, vector<Key>> gridGraph(size_t rows, //rows of the grid
+    size_t columns)//columns of the grid
+  {
+    size_t tasks = (rows + pprInternal::generatorChunk - 1) / pprInternal::generatorChunk;
+    return pprInternal::generateGraph<Key>(rows * columns, tasks, 0, 1,
+      [=](size_t task, xoshiro256&, vector<pair<size_t, size_t>>& taskEdges)
+      {
+        for(size_t r = task * pprInternal::generatorChunk, rEnd = std::min(rows, r + pprInternal::generatorChunk);
+          r < rEnd; r++)
+          for(size_t c = 0; c < columns; c++)
+          {
+            size_t u = r * columns + c;
+            if(r > 0) taskEdges.push_back(std::make_pair(u, u - columns));
+            if(r + 1 < rows) taskEdges.push_back(std::make_pair(u, u + columns));
+            if(c > 0) taskEdges.push_back(std::make_pair(u, u - 1));
+            if(c + 1 < columns) taskEdges.push_back(std::make_pair(u, u + 1));
+          }
+      });
+  }
+
+  /**
+   * Random directed acyclic graph: node u links to outdegree nodes picked at
+   * random among the ones after it (all of them if there are fewer), so the
+   * ids are a topological order and the last node has no successors.
+   * Successors may be repeated.
+   * @param n         Number of nodes.
+   * @param outdegree Outdegree of each node with enough nodes after it.
+   * @param seed
+   * @param nThreads  Number of threads to use (one at least).
+   */
+  template<typename Key>
+  unordered_map<Key, vector<Key>> dagGraph(size_t n, //number of nodes
+    size_t outdegree,//outdegree of each node
+    uint64_t seed,//seed of the generator
+    size_t nThreads)//number of threads, at least 1
+  {
+    if(nThreads == 0){cerr << "nThreads must be positive" << endl; exit(EXIT_FAILURE);}
+
+    size_t tasks = (n + pprInternal::generatorChunk - 1) / pprInternal::generatorChunk;
+    return pprInternal::generateGraph<Key>(n, tasks, seed, nThreads,
+      [=](size_t task, xoshiro256& generator, vector<pair<size_t, size_t>>& taskEdges)
+      {
+        for(size_t u = task * pprInternal::generatorChunk, uEnd = std::min(n, u + pprInternal::generatorChunk);
+          u < uEnd; u++)
+        {
+          size_t after = n - u - 1;
+          if(after <= outdegree)
+            for(size_t v = u + 1; v < n; v++)
+              taskEdges.push_back(std::make_pair(u, v));
+          else
+            for(size_t e = 0; e < outdegree; e++)
+              taskEdges.push_back(std::make_pair(u, u + 1 + generator() % after));
+        }
+      });
+  }
+}
+#endif
@@ -0,0 +1,124 @@
+#ifndef GRANKOBSERVER_H
+#define GRANKOBSERVER_H
+
+#include <chrono>
+#include <ostream>
+
+namespace ppr
+{
+  /**
+   * Statistics of an iteration of grank or grankMulti, an iteration recomputes
+   * the maps of the nodes of one of the two partitions.
+   */
+  struct grankIteration
+  {
+    size_t iteration = 0;//index of the iteration, from 0
+    size_t partition = 0;//partition processed, 0 or 1
+    double maxDiff = 0;//max norm-1 between the old and new map of the nodes of the partition
+    size_t nodes = 0;//nodes recomputed
+    size_t merged = 0;//entries of the maps of the successors merged
+    size_t dropped = 0;//entries dropped by keepTop
+    size_t allocations = 0;//maps and map entries allocated
+    double combineSeconds = 0;//time spent combining the maps of the successors
+    double keepTopSeconds = 0;//time spent in keepTop
+    double norm1Seconds = 0;//time spent in norm1
+    double seconds = 0;//wall clock time of the iteration
+  };
+
+  /**
+   * Observer of the iterations of grank and grankMulti, which call iteration()
+   * at the end of each iteration (from the calling thread).
+   */
+  class grankObserver
+  {
+    public:
+      virtual ~grankObserver() {}
+      virtual void iteration(const grankIteration& stats) = 0;
+  };
+
+  /**
+   * Observer writing each iteration to a stream as a line of json, e.g. to
+   * follow the convergence of a long run with "tail -f".
+   */
+  class grankJsonLines: public grankObserver
+  {
+    public:
+      explicit grankJsonLines(std::ostream& out) : out(out) {}
+
+      void iteration(const grankIteration& stats)
+      {
+        out << "{\"iteration\": " << stats.iteration << ", \"partition\": " << stats.partition
+          << ", \"maxDiff\": " << stats.maxDiff << ", \"nodes\": " << stats.nodes << ", \"merged\": " << stats.merged
+          << ", \"dropped\": " << stats.dropped << ", \"allocations\": " << stats.allocations
+          << ", \"combineSeconds\": " << stats.combineSeconds << ", \"keepTopSeconds\": " << stats.keepTopSeconds
+          << ", \"norm1Seconds\": " << stats.norm1Seconds << ", \"seconds\": " << stats.seconds << "}" << std::endl;
+      }
+
+    private:
+      std::ostream& out;
+  };
+
+  namespace pprInternal
+  {
+    /**
+     * Adds the time passed since the previous lap to a counter, doing nothing
+     * (not even reading the clock) when disabled.
+     */
+    class phaseTimer
+    {
+      public:
+        explicit phaseTimer(bool enabled) : enabled(enabled)
+        {
+          if(enabled)
+            last = std::chrono::steady_clock::now();
+        }
+
+        inline void lap(double& seconds)
+        {
+          if(!enabled)
+            return;
+          std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+          seconds += std::chrono::duration<double>(now - last).count();
+          last = now;
+        }
+
+      private:
+        bool enabled;
+        std::chrono::steady_clock::time_point last;
+    };
+
+    /**
+     * Count the work of recomputing the map of a node into the stats of an
+     * iteration: the new map allocates its buckets and an entry for each key it
+     * got before keepTop.
+     * @param stats   Stats of the iteration.
+     * @param merged  Entries of the maps of the successors merged.
+     * @param entries Entries of the new map before keepTop.
+     * @param kept    Entries of the new map after keepTop.
+     */
+    inline void countNode(grankIteration& stats, size_t merged, size_t entries, size_t kept)
+    {
+      stats.nodes++;
+      stats.merged += merged;
+      stats.dropped += entries - kept;
+      stats.allocations += entries + 1;
+    }
+
+    /**
+     * Add the counters and times of the stats of a thread to the ones of the
+     * iteration, keeping the max of the maxDiffs.
+     */
+    inline void addIteration(grankIteration& stats, const grankIteration& thread)
+    {
+      stats.maxDiff = (thread.maxDiff > stats.maxDiff)? thread.maxDiff : stats.maxDiff;
+      stats.nodes += thread.nodes;
+      stats.merged += thread.merged;
+      stats.dropped += thread.dropped;
+      stats.allocations += thread.allocations;
+      stats.combineSeconds += thread.combineSeconds;
+      stats.keepTopSeconds += thread.keepTopSeconds;
+      stats.norm1Seconds += thread.norm1Seconds;
+    }
+  }
+}
+#endif
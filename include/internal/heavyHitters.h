@@ -0,0 +1,244 @@
+#ifndef HEAVYHITTERS_H
+#define HEAVYHITTERS_H
+
+#include <stdint.h>
+#include <utility>//pair
+#include <vector>
+
+#include <internal/pprGraph.h>//PPR_PREFETCH
+
+using std::pair;
+using std::vector;
+
+namespace ppr
+{
+  namespace pprInternal
+  {
+    //slot of an id which is not counted by a spaceSaving
+    const size_t noSlot = SIZE_MAX;
+
+    /**
+     * Space-Saving counter (Metwally, Agrawal, El Abbadi) over dense ids,
+     * keeping the approximate counts of the most frequent ids in fixed memory.
+     * Counts only grow by one at a time, so entries are kept in buckets of
+     * equal count (the "stream summary") and every update is O(1): an id not
+     * counted yet replaces one of the ids with the min count, inheriting its
+     * count, which is then an upper bound on the true count of the new id.
+     * Ids with a true count greater than the min count are never evicted.
+     * The position of each id in the counter is kept in a dense array of the
+     * size of the graph, which is provided by the caller so that it can be
+     * reused between counters (clear() leaves it as it was found).
+     */
+    class spaceSaving
+    {
+      public:
+        /**
+         * @param capacity Max number of ids counted at the same time.
+         * @param slots    Slot of each id, all must be noSlot; shared scratch.
+         */
+        spaceSaving(size_t capacity, vector<size_t>& slots): capacity(capacity), slots(slots),
+          head(noSlot), freeBucket(noSlot)
+        {
+          ids.reserve(capacity);
+          entryBucket.reserve(capacity);
+          entryPrev.reserve(capacity);
+          entryNext.reserve(capacity);
+          errors.reserve(capacity);
+        }
+
+        ~spaceSaving() { clear(); }
+
+        spaceSaving(const spaceSaving&) = delete;
+        spaceSaving& operator=(const spaceSaving&) = delete;
+
+        /**
+         * Count one more occurrence of an id.
+         */
+        inline void increment(size_t id)
+        {
+          size_t entry = slots[id];
+          if(entry != noSlot)
+          {
+            bump(entry);
+            return;
+          }
+          if(capacity == 0)
+            return;
+
+          if(ids.size() < capacity)
+          {
+            entry = ids.size();
+            ids.push_back(id);
+            entryBucket.push_back(noSlot);
+            entryPrev.push_back(noSlot);
+            entryNext.push_back(noSlot);
+            errors.push_back(0);
+            slots[id] = entry;
+
+            //new entries have a count of 1, which is the lowest possible one
+            if(head == noSlot || counts[head] != 1)
+            {
+              size_t bucket = newBucket(1);
+              linkBucket(bucket, noSlot, head);
+            }
+            attach(entry, head);
+            return;
+          }
+
+          //replace an entry with the min count
+          entry = firstEntry[head];
+          slots[ids[entry]] = noSlot;
+          ids[entry] = id;
+          errors[entry] = counts[head];
+          slots[id] = entry;
+          bump(entry);
+        }
+
+        /**
+         * Hint that an id is going to be counted soon.
+         */
+        inline void prefetch(size_t id) const { PPR_PREFETCH(&slots[id]); }
+
+        /**
+         * Number of ids currently counted.
+         */
+        inline size_t size() const { return ids.size(); }
+
+        /**
+         * Estimated counts (upper bounds) of the counted ids, in no particular order.
+         */
+        inline vector<pair<size_t, double>> entries() const
+        {
+          vector<pair<size_t, double>> res; res.reserve(ids.size());
+          for(size_t e = 0; e < ids.size(); e++)
+            res.push_back(std::make_pair(ids[e], static_cast<double>(counts[entryBucket[e]])));
+          return res;
+        }
+
+        /**
+         * Estimated counts minus their error, which are lower bounds on the true
+         * counts, so that ids which have just replaced another one are not ranked
+         * above ids that have been counted since the start.
+         */
+        inline vector<pair<size_t, double>> guaranteedEntries() const
+        {
+          vector<pair<size_t, double>> res; res.reserve(ids.size());
+          for(size_t e = 0; e < ids.size(); e++)
+            res.push_back(std::make_pair(ids[e], static_cast<double>(counts[entryBucket[e]] - errors[e])));
+          return res;
+        }
+
+        /**
+         * Max overestimation of the count of an id (0 if it has never been evicted).
+         */
+        inline size_t error(size_t id) const
+        {
+          return (slots[id] == noSlot)? 0 : errors[slots[id]];
+        }
+
+        /**
+         * Remove every id, resetting their slots to noSlot.
+         */
+        inline void clear()
+        {
+          for(size_t id: ids)
+            slots[id] = noSlot;
+          ids.clear(); entryBucket.clear(); entryPrev.clear(); entryNext.clear(); errors.clear();
+          counts.clear(); firstEntry.clear(); bucketPrev.clear(); bucketNext.clear();
+          head = freeBucket = noSlot;
+        }
+
+      private:
+        //move an entry to the bucket with its count + 1
+        inline void bump(size_t entry)
+        {
+          size_t bucket = entryBucket[entry];
+          size_t count = counts[bucket] + 1;
+          size_t next = bucketNext[bucket];
+          if(next == noSlot || counts[next] != count)
+          {
+            next = newBucket(count);
+            linkBucket(next, bucket, bucketNext[bucket]);
+          }
+          detach(entry);
+          attach(entry, next);
+          if(firstEntry[bucket] == noSlot)
+            unlinkBucket(bucket);
+        }
+
+        inline size_t newBucket(size_t count)
+        {
+          size_t bucket;
+          if(freeBucket != noSlot)
+          {
+            bucket = freeBucket;
+            freeBucket = bucketNext[bucket];
+          }
+          else
+          {
+            bucket = counts.size();
+            counts.push_back(0); firstEntry.push_back(noSlot); bucketPrev.push_back(noSlot); bucketNext.push_back(noSlot);
+          }
+          counts[bucket] = count;
+          firstEntry[bucket] = noSlot;
+          return bucket;
+        }
+
+        inline void linkBucket(size_t bucket, size_t prev, size_t next)
+        {
+          bucketPrev[bucket] = prev;
+          bucketNext[bucket] = next;
+          if(prev == noSlot) head = bucket; else bucketNext[prev] = bucket;
+          if(next != noSlot) bucketPrev[next] = bucket;
+        }
+
+        inline void unlinkBucket(size_t bucket)
+        {
+          size_t prev = bucketPrev[bucket];
+          size_t next = bucketNext[bucket];
+          if(prev == noSlot) head = next; else bucketNext[prev] = next;
+          if(next != noSlot) bucketPrev[next] = prev;
+          bucketNext[bucket] = freeBucket;
+          freeBucket = bucket;
+        }
+
+        inline void attach(size_t entry, size_t bucket)
+        {
+          entryBucket[entry] = bucket;
+          entryPrev[entry] = noSlot;
+          entryNext[entry] = firstEntry[bucket];
+          if(firstEntry[bucket] != noSlot)
+            entryPrev[firstEntry[bucket]] = entry;
+          firstEntry[bucket] = entry;
+        }
+
+        inline void detach(size_t entry)
+        {
+          size_t bucket = entryBucket[entry];
+          if(entryPrev[entry] == noSlot) firstEntry[bucket] = entryNext[entry];
+          else entryNext[entryPrev[entry]] = entryNext[entry];
+          if(entryNext[entry] != noSlot)
+            entryPrev[entryNext[entry]] = entryPrev[entry];
+        }
+
+        size_t capacity;
+        vector<size_t>& slots;
+
+        //entries
+        vector<size_t> ids;
+        vector<size_t> entryBucket;
+        vector<size_t> entryPrev;
+        vector<size_t> entryNext;
+        vector<size_t> errors;
+
+        //buckets, linked by increasing count
+        vector<size_t> counts;
+        vector<size_t> firstEntry;
+        vector<size_t> bucketPrev;
+        vector<size_t> bucketNext;
+        size_t head;//bucket with the min count
+        size_t freeBucket;
+    };
+  }
+}
+#endif
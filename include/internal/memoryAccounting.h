@@ -0,0 +1,412 @@
+#ifndef MEMORYACCOUNTING_H
+#define MEMORYACCOUNTING_H
+
+#include <algorithm>//min, max
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <stdlib.h>//malloc
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>//pair
+#include <vector>
+
+namespace ppr
+{
+  /**
+   * Categories of the memory allocated by the algorithms: the graph (the dense
+   * copies and transposes built by the algorithms, and the input graph if it is
+   * loaded in a memoryScope of this category), the score maps and the scratch
+   * buffers of a run (partitions, execution orders, walk indexes...).
+   * Memory allocated out of any memoryScope is "other".
+   */
+  enum memoryCategory
+  {
+    memoryOther = 0,
+    memoryGraph,
+    memoryScores,
+    memoryScratch,
+    memoryCategories//number of categories
+  };
+
+  /**
+   * Peak memory of a phase (see memoryPhase), in bytes requested to operator new.
+   */
+  struct memoryPhaseReport
+  {
+    std::string name;
+    size_t peak[memoryCategories];//max live bytes of each category during the phase
+    size_t peakTotal;//max live bytes of all the categories together during the phase
+  };
+
+  namespace pprInternal
+  {
+    //bytes before each accounted block, keeping the alignment given by malloc
+    const size_t memoryHeader = 16;
+
+    struct memoryCounters
+    {
+      std::atomic<bool> enabled;
+      std::atomic<size_t> live[memoryCategories];
+      std::atomic<size_t> peak[memoryCategories];
+      std::atomic<size_t> liveTotal;
+      std::atomic<size_t> peakTotal;
+      std::atomic<size_t> allocated;//bytes allocated so far, freed or not
+      std::mutex mutex;
+      std::vector<memoryPhaseReport> phases;
+    };
+
+    //counters of the process, zero initialized before any allocation
+    inline memoryCounters& memoryCountersOf()
+    {
+      static memoryCounters counters;
+      return counters;
+    }
+
+    //category of the allocations of the calling thread
+    inline memoryCategory& currentMemoryCategory()
+    {
+      static thread_local memoryCategory category = memoryOther;
+      return category;
+    }
+
+    inline void atomicMax(std::atomic<size_t>& value, size_t candidate)
+    {
+      size_t current = value.load(std::memory_order_relaxed);
+      while(candidate > current && !value.compare_exchange_weak(current, candidate, std::memory_order_relaxed));
+    }
+
+    /**
+     * Allocate a block recording its size and category in a header before it,
+     * so that it can be accounted when it is freed (on any thread).
+     */
+    inline void* accountedAllocate(size_t size, bool nothrow)
+    {
+      size_t* header = static_cast<size_t*>(malloc(size + memoryHeader));
+      if(header == nullptr)
+      {
+        if(nothrow)
+          return nullptr;
+        throw std::bad_alloc();
+      }
+      memoryCategory category = currentMemoryCategory();
+      header[0] = size;
+      header[1] = category;
+
+      memoryCounters& counters = memoryCountersOf();
+      atomicMax(counters.peak[category], counters.live[category].fetch_add(size, std::memory_order_relaxed) + size);
+      atomicMax(counters.peakTotal, counters.liveTotal.fetch_add(size, std::memory_order_relaxed) + size);
+      counters.allocated.fetch_add(size, std::memory_order_relaxed);
+      return reinterpret_cast<char*>(header) + memoryHeader;
+    }
+
+    inline void accountedFree(void* p)
+    {
+      if(p == nullptr)
+        return;
+      size_t* header = reinterpret_cast<size_t*>(static_cast<char*>(p) - memoryHeader);
+      memoryCounters& counters = memoryCountersOf();
+      counters.live[header[1]].fetch_sub(header[0], std::memory_order_relaxed);
+      counters.liveTotal.fetch_sub(header[0], std::memory_order_relaxed);
+      free(header);
+    }
+
+    /**
+     * Allocate a block only counting its bytes, see PPR_MEMORY_COUNTING.
+     */
+    inline void* countedAllocate(size_t size, bool nothrow)
+    {
+      void* p = malloc(size);
+      if(p == nullptr)
+      {
+        if(nothrow)
+          return nullptr;
+        throw std::bad_alloc();
+      }
+      memoryCountersOf().allocated.fetch_add(size, std::memory_order_relaxed);
+      return p;
+    }
+
+    //switched on by PPR_MEMORY_ACCOUNTING, before main
+    struct memoryAccountingSwitch
+    {
+      memoryAccountingSwitch() { memoryCountersOf().enabled.store(true); }
+    };
+  }
+
+  /**
+   * True if the operators of PPR_MEMORY_ACCOUNTING are in the program.
+   */
+  inline bool memoryAccountingEnabled()
+  {
+    return pprInternal::memoryCountersOf().enabled.load();
+  }
+
+  /**
+   * Live bytes of a category, 0 without PPR_MEMORY_ACCOUNTING.
+   */
+  inline size_t liveMemory(memoryCategory category)
+  {
+    return pprInternal::memoryCountersOf().live[category].load(std::memory_order_relaxed);
+  }
+
+  /**
+   * Bytes allocated so far in all the categories, including the ones already
+   * freed (i.e. the allocations of a call are the difference before and after
+   * it), 0 without PPR_MEMORY_ACCOUNTING nor PPR_MEMORY_COUNTING.
+   */
+  inline size_t allocatedMemory()
+  {
+    return pprInternal::memoryCountersOf().allocated.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * Reports of the phases ended so far, in the order they ended.
+   */
+  inline std::vector<memoryPhaseReport> memoryPhases()
+  {
+    pprInternal::memoryCounters& counters = pprInternal::memoryCountersOf();
+    std::lock_guard<std::mutex> lock(counters.mutex);
+    return counters.phases;
+  }
+
+  inline void clearMemoryPhases()
+  {
+    pprInternal::memoryCounters& counters = pprInternal::memoryCountersOf();
+    std::lock_guard<std::mutex> lock(counters.mutex);
+    counters.phases.clear();
+  }
+
+  /**
+   * Allocations of the calling thread are accounted to a category while the
+   * scope is alive, scopes can be nested. The category can be changed with
+   * set(), the one before the scope is restored when it is destroyed.
+   */
+  class memoryScope
+  {
+    public:
+      explicit memoryScope(memoryCategory category) : previous(pprInternal::currentMemoryCategory())
+      {
+        pprInternal::currentMemoryCategory() = category;
+      }
+
+      void set(memoryCategory category)
+      {
+        pprInternal::currentMemoryCategory() = category;
+      }
+
+      ~memoryScope()
+      {
+        pprInternal::currentMemoryCategory() = previous;
+      }
+
+    private:
+      memoryScope(const memoryScope&);
+      memoryScope& operator=(const memoryScope&);
+      memoryCategory previous;
+  };
+
+  /**
+   * A phase of a run (the algorithms have their own, e.g. "grank iterations"):
+   * when it ends, with end() or when destroyed, the peak of each category while
+   * it was alive is added to memoryPhases(). Phases can be nested, but should
+   * not overlap on different threads. Nothing is done without PPR_MEMORY_ACCOUNTING.
+   */
+  class memoryPhase
+  {
+    public:
+      explicit memoryPhase(const std::string& name) : name(name), active(memoryAccountingEnabled())
+      {
+        if(!active)
+          return;
+        //peaks so far, for the enclosing phase, are restored at the end
+        pprInternal::memoryCounters& counters = pprInternal::memoryCountersOf();
+        for(size_t c = 0; c < memoryCategories; c++)
+          saved[c] = counters.peak[c].exchange(counters.live[c].load());
+        savedTotal = counters.peakTotal.exchange(counters.liveTotal.load());
+      }
+
+      void end()
+      {
+        if(!active)
+          return;
+        active = false;
+        pprInternal::memoryCounters& counters = pprInternal::memoryCountersOf();
+        memoryPhaseReport report;
+        report.name = name;
+        for(size_t c = 0; c < memoryCategories; c++)
+        {
+          report.peak[c] = counters.peak[c].load();
+          pprInternal::atomicMax(counters.peak[c], saved[c]);
+        }
+        report.peakTotal = counters.peakTotal.load();
+        pprInternal::atomicMax(counters.peakTotal, savedTotal);
+        //the reports are not part of any category
+        memoryScope scope(memoryOther);
+        std::lock_guard<std::mutex> lock(counters.mutex);
+        counters.phases.push_back(report);
+      }
+
+      ~memoryPhase()
+      {
+        end();
+      }
+
+    private:
+      memoryPhase(const memoryPhase&);
+      memoryPhase& operator=(const memoryPhase&);
+      std::string name;
+      bool active;
+      size_t saved[memoryCategories];
+      size_t savedTotal;
+  };
+
+  /**
+   * Predicted peak memory of a run, in bytes, split by category.
+   */
+  struct memoryEstimate
+  {
+    size_t graph = 0;//the input graph and the copies of the algorithm
+    size_t scores = 0;//the score maps
+    size_t scratch = 0;//the buffers of the run
+    size_t total = 0;
+  };
+
+  namespace pprInternal
+  {
+    /**
+     * Bytes of the entries of an unordered_map (libstdc++ layout): a node with
+     * the next pointer, the pair and the hash code, which is kept for the keys
+     * whose hash is not trivial.
+     */
+    template<typename Key, typename Value>
+    inline size_t mapEntryBytes()
+    {
+      return sizeof(void*) + sizeof(std::pair<const Key, Value>) +
+        ((std::is_arithmetic<Key>::value || std::is_pointer<Key>::value)? 0 : sizeof(size_t));
+    }
+
+    /**
+     * Bytes of an unordered_map with "entries" entries and "buckets" buckets.
+     */
+    template<typename Key, typename Value>
+    inline size_t mapBytes(size_t entries, size_t buckets)
+    {
+      return entries * mapEntryBytes<Key, Value>() + buckets * sizeof(void*);
+    }
+
+    /**
+     * Bytes of a graph as an unordered_map of vectors (the input of the algorithms),
+     * with the vectors filled by push_back: growing by doubling they have about
+     * 1 / ln(2) times the capacity they need.
+     */
+    template<typename Key>
+    inline size_t graphBytes(size_t nodes, size_t edges)
+    {
+      return mapBytes<Key, std::vector<Key>>(nodes, nodes) + static_cast<size_t>(1.44 * edges * sizeof(Key));
+    }
+  }
+
+  /**
+   * Predicted peak memory of grank on a graph with the given nodes and edges:
+   * the input graph, the two score maps of every node (the one of the previous
+   * iteration and the one being computed), full with min(L, nodes) entries, and
+   * the scratch of the partitions. The maps of a node keep the buckets of its
+   * combination, which has up to outdegree * L entries before keepTop, so the
+   * buckets are estimated with the average outdegree.
+   * @param nodes
+   * @param edges
+   * @param L
+   */
+  template<typename Key>
+  memoryEstimate grankMemoryEstimate(size_t nodes, size_t edges, size_t L)
+  {
+    using pprInternal::mapBytes;
+    memoryEstimate estimate;
+    if(nodes == 0)
+      return estimate;
+    size_t entries = std::min(L, nodes);
+    size_t combined = std::min(nodes, std::max(entries, edges * entries / nodes));
+    estimate.graph = pprInternal::graphBytes<Key>(nodes, edges);
+    estimate.scores = 2 * (mapBytes<Key, std::unordered_map<Key, double>>(nodes, nodes) +
+      nodes * mapBytes<Key, double>(entries, combined));
+    //the predecessors and the two partitions of findPartitions
+    estimate.scratch = pprInternal::graphBytes<Key>(nodes, edges) + 2 * mapBytes<Key, char>(nodes, nodes);
+    estimate.total = estimate.graph + estimate.scores + estimate.scratch;
+    return estimate;
+  }
+
+  /**
+   * Predicted peak memory of mccompletepathv2 on a graph with the given nodes
+   * and edges: the input graph with the dense copy and its transpose, the map of
+   * every node, full with min(L, nodes) entries and with the buckets of the
+   * combination of its successors (outdegree * L), and the per node scratch.
+   * @param nodes
+   * @param edges
+   * @param L
+   */
+  template<typename Key>
+  memoryEstimate mccompletepathv2MemoryEstimate(size_t nodes, size_t edges, size_t L)
+  {
+    using pprInternal::mapBytes;
+    memoryEstimate estimate;
+    if(nodes == 0)
+      return estimate;
+    size_t entries = std::min(L, nodes);
+    size_t combined = std::min(nodes, std::max(entries, edges * entries / nodes));
+    //keys, ids, offsets and targets of the dense graph and of its transpose
+    size_t dense = nodes * sizeof(Key) + mapBytes<Key, size_t>(nodes, nodes) + 2 * (nodes + 1 + edges) * sizeof(size_t);
+    estimate.graph = pprInternal::graphBytes<Key>(nodes, edges) + dense;
+    estimate.scores = nodes * (sizeof(std::unordered_map<size_t, double>) + mapBytes<size_t, double>(entries, combined));
+    //walk indexes, counter slots, the execution order, the components and
+    //counters of sccExecutionOrder and its visit, which can hold an entry per edge
+    estimate.scratch = (10 * nodes + edges) * sizeof(size_t);
+    estimate.total = estimate.graph + estimate.scores + estimate.scratch;
+    return estimate;
+  }
+}
+
+/**
+ * Define in one translation unit of a program (at global scope) to account
+ * the memory allocated with operator new to the categories of memoryScope and
+ * to the phases of memoryPhase, e.g. in main.cc:
+ *   #include <internal/memoryAccounting.h>
+ *   PPR_MEMORY_ACCOUNTING
+ * It replaces the global operator new and delete, adding a header of 16 bytes
+ * to each block and updating counters shared by all the threads, so it slows
+ * down allocations: builds which time the algorithms should not define it
+ * (src/main.cc only does in the pprMemory build).
+ */
+#define PPR_MEMORY_ACCOUNTING \
+  void* operator new(size_t size) { return ppr::pprInternal::accountedAllocate(size, false); } \
+  void* operator new[](size_t size) { return ppr::pprInternal::accountedAllocate(size, false); } \
+  void* operator new(size_t size, const std::nothrow_t&) noexcept { return ppr::pprInternal::accountedAllocate(size, true); } \
+  void* operator new[](size_t size, const std::nothrow_t&) noexcept { return ppr::pprInternal::accountedAllocate(size, true); } \
+  void operator delete(void* p) noexcept { ppr::pprInternal::accountedFree(p); } \
+  void operator delete[](void* p) noexcept { ppr::pprInternal::accountedFree(p); } \
+  void operator delete(void* p, size_t) noexcept { ppr::pprInternal::accountedFree(p); } \
+  void operator delete[](void* p, size_t) noexcept { ppr::pprInternal::accountedFree(p); } \
+  void operator delete(void* p, const std::nothrow_t&) noexcept { ppr::pprInternal::accountedFree(p); } \
+  void operator delete[](void* p, const std::nothrow_t&) noexcept { ppr::pprInternal::accountedFree(p); } \
+  static ppr::pprInternal::memoryAccountingSwitch pprMemoryAccountingSwitch;
+
+/**
+ * Lighter alternative to PPR_MEMORY_ACCOUNTING (a program defines at most one
+ * of the two), for the builds which time the code they measure the allocations
+ * of, e.g. src/pprBench.cc: operator new only adds the bytes requested to
+ * allocatedMemory(), without headers, categories, peaks nor phases.
+ */
+#define PPR_MEMORY_COUNTING \
+  void* operator new(size_t size) { return ppr::pprInternal::countedAllocate(size, false); } \
+  void* operator new[](size_t size) { return ppr::pprInternal::countedAllocate(size, false); } \
+  void* operator new(size_t size, const std::nothrow_t&) noexcept { return ppr::pprInternal::countedAllocate(size, true); } \
+  void* operator new[](size_t size, const std::nothrow_t&) noexcept { return ppr::pprInternal::countedAllocate(size, true); } \
+  void operator delete(void* p) noexcept { free(p); } \
+  void operator delete[](void* p) noexcept { free(p); } \
+  void operator delete(void* p, size_t) noexcept { free(p); } \
+  void operator delete[](void* p, size_t) noexcept { free(p); } \
+  void operator delete(void* p, const std::nothrow_t&) noexcept { free(p); } \
+  void operator delete[](void* p, const std::nothrow_t&) noexcept { free(p); }
+#endif
@@ -0,0 +1,125 @@
+#ifndef PAGERANKCACHE_H
+#define PAGERANKCACHE_H
+
+#include <fstream>
+#include <stdint.h>
+#include <string.h>//memcpy
+#include <string>
+#include <unordered_map>
+#include <utility>//pair
+#include <vector>
+
+using std::pair;
+using std::string;
+using std::unordered_map;
+using std::vector;
+
+namespace ppr
+{
+  namespace pprInternal
+  {
+    /**
+     * Pagerank of source nodes saved to a file, so that benchmarks run again
+     * on the same graph don't compute it again. Nodes are dense ids of the
+     * graph (see denseGraph), and the cache is only valid for the graph with
+     * the same fingerprint and for the same pagerank parameters.
+     */
+    struct pagerankCache
+    {
+      uint64_t graph = 0;//fingerprint of the graph
+      size_t n = 0;//nodes of the graph
+      size_t iterations = 0;
+      double damping = 0;
+      double tolerance = 0;
+      size_t topN = 0;//nodes kept of each pagerank, 0 for all of them
+      unordered_map<size_t, vector<pair<size_t, double>>> scores;//pagerank of each source
+
+      /**
+       * Save the cache to a file (native byte order), false on failure.
+       */
+      bool save(const string& path) const
+      {
+        std::ofstream out(path, std::ios::binary);
+        if(!out)
+          return false;
+        uint64_t header[] = {magic, graph, n, iterations, bits(damping), bits(tolerance), topN, scores.size()};
+        out.write(reinterpret_cast<const char*>(header), sizeof(header));
+        for(const auto& keyVal: scores)
+        {
+          uint64_t entry[] = {keyVal.first, keyVal.second.size()};
+          out.write(reinterpret_cast<const char*>(entry), sizeof(entry));
+          for(const auto& score: keyVal.second)
+          {
+            uint64_t words[] = {score.first, bits(score.second)};
+            out.write(reinterpret_cast<const char*>(words), sizeof(words));
+          }
+        }
+        return static_cast<bool>(out);
+      }
+
+      /**
+       * Load the cache saved for the same graph and with the same parameters,
+       * false (leaving the cache untouched) if there is no such file.
+       * @param path
+       * @param graph      Fingerprint of the graph.
+       * @param n          Nodes of the graph.
+       * @param iterations Pagerank max iterations.
+       * @param damping    Pagerank damping factor.
+       * @param tolerance  Pagerank tolerance.
+       * @param topN       Nodes kept of each pagerank.
+       */
+      bool load(const string& path, uint64_t graph, size_t n, size_t iterations, double damping, double tolerance,
+        size_t topN)
+      {
+        std::ifstream in(path, std::ios::binary);
+        if(!in)
+          return false;
+        uint64_t header[8];
+        in.read(reinterpret_cast<char*>(header), sizeof(header));
+        if(!in || header[0] != magic || header[1] != graph || header[2] != n || header[3] != iterations ||
+          header[4] != bits(damping) || header[5] != bits(tolerance) || header[6] != topN)
+          return false;
+
+        unordered_map<size_t, vector<pair<size_t, double>>> newScores;
+        newScores.reserve(header[7]);
+        for(uint64_t i = 0; i < header[7]; i++)
+        {
+          uint64_t entry[2];
+          if(!in.read(reinterpret_cast<char*>(entry), sizeof(entry)) || entry[0] >= n || entry[1] > n)
+            return false;
+          vector<pair<size_t, double>>& source = newScores[entry[0]];
+          source.reserve(entry[1]);
+          for(uint64_t j = 0; j < entry[1]; j++)
+          {
+            uint64_t words[2];
+            if(!in.read(reinterpret_cast<char*>(words), sizeof(words)) || words[0] >= n)
+              return false;
+            source.push_back(std::make_pair(static_cast<size_t>(words[0]), fromBits(words[1])));
+          }
+        }
+        this->graph = graph; this->n = n; this->iterations = iterations; this->damping = damping;
+        this->tolerance = tolerance; this->topN = topN;
+        scores.swap(newScores);
+        return true;
+      }
+
+      private:
+        static const uint64_t magic = 0x31525047525050ULL;//"PPRGPR1"
+
+        static uint64_t bits(double value)
+        {
+          uint64_t word;
+          memcpy(&word, &value, sizeof(word));
+          return word;
+        }
+
+        static double fromBits(uint64_t word)
+        {
+          double value;
+          memcpy(&value, &word, sizeof(value));
+          return value;
+        }
+    };
+  }
+}
+#endif
@@ -0,0 +1,209 @@
+#ifndef PPRGRAPH_H
+#define PPRGRAPH_H
+
+#include <algorithm>//min
+#include <functional>//hash
+#include <stdint.h>
+#include <unordered_map>
+#include <utility>//pair
+#include <vector>
+
+using std::pair;
+using std::unordered_map;
+using std::vector;
+
+//hint that an address is going to be read soon
+#if defined(__GNUC__)
+#define PPR_PREFETCH(address) __builtin_prefetch(address)
+#else
+#define PPR_PREFETCH(address)
+#endif
+
+namespace ppr
+{
+  namespace pprInternal
+  {
+    /**
+     * Compressed sparse row adjacency over dense node ids, the neighbours of
+     * node i are targets[offsets[i]], ..., targets[offsets[i + 1] - 1].
+     */
+    struct adjacency
+    {
+      vector<size_t> offsets;
+      vector<size_t> targets;
+
+      inline size_t degree(size_t node) const { return offsets[node + 1] - offsets[node]; }
+      inline const size_t* begin(size_t node) const { return targets.data() + offsets[node]; }
+      inline const size_t* end(size_t node) const { return targets.data() + offsets[node + 1]; }
+    };
+
+    /**
+     * Copy of a graph where nodes are mapped to dense ids in [0, n), ids follow
+     * the iteration order of the unordered_map the graph was built from.
+     */
+    template<typename Key>
+    struct denseGraph
+    {
+      vector<Key> keys;//id -> node
+      unordered_map<Key, size_t> ids;//node -> id
+      adjacency successors;
+
+      inline size_t size() const { return keys.size(); }
+    };
+
+    /**
+     * Build the dense copy of a graph, successors keep their order (and
+     * repetitions).
+     * @param graph Graph to copy.
+     */
+    template<typename Key>
+    denseGraph<Key> makeDenseGraph(const unordered_map<Key, vector<Key>>& graph)
+    {
+      denseGraph<Key> g;
+      g.keys.reserve(graph.size());
+      g.ids.reserve(graph.size());
+      size_t edges = 0;
+      for(const auto& keyVal: graph)
+      {
+        g.ids.insert(std::make_pair(keyVal.first, g.keys.size()));
+        g.keys.push_back(keyVal.first);
+        edges += keyVal.second.size();
+      }
+
+      g.successors.offsets.reserve(graph.size() + 1);
+      g.successors.targets.reserve(edges);
+      g.successors.offsets.push_back(0);
+      for(const Key& node: g.keys)
+      {
+        for(const Key& successor: graph.find(node)->second)
+          g.successors.targets.push_back(g.ids.find(successor)->second);
+        g.successors.offsets.push_back(g.successors.targets.size());
+      }
+      return g;
+    }
+
+    /**
+     * Fingerprint of a dense graph (its nodes, with their ids, and its edges),
+     * to check that data saved for a graph is used with the same graph.
+     * @param g Graph to fingerprint.
+     */
+    template<typename Key>
+    uint64_t fingerprint(const denseGraph<Key>& g)
+    {
+      //FNV-1a over 64 bit words, with a final avalanche
+      uint64_t h = 0xcbf29ce484222325ULL;
+      auto mix = [&h](uint64_t word) { h = (h ^ word) * 0x100000001b3ULL; };
+      mix(g.size());
+      std::hash<Key> hasher;
+      for(const Key& key: g.keys)
+        mix(hasher(key));
+      for(size_t offset: g.successors.offsets)
+        mix(offset);
+      for(size_t target: g.successors.targets)
+        mix(target);
+      h ^= h >> 33; h *= 0xff51afd7ed558ccdULL;
+      h ^= h >> 33; h *= 0xc4ceb9fe1a85ec53ULL;
+      return h ^ (h >> 33);
+    }
+
+    /**
+     * Transpose of an adjacency (i.e. predecessors from successors), for each
+     * node the neighbours are sorted by id.
+     * @param a Adjacency to transpose.
+     */
+    inline adjacency transpose(const adjacency& a)
+    {
+      size_t n = a.offsets.size() - 1;
+      adjacency t;
+      t.offsets.assign(n + 1, 0);
+      t.targets.resize(a.targets.size());
+
+      //counting sort of the edges by their target
+      for(size_t target: a.targets)
+        t.offsets[target + 1]++;
+      for(size_t i = 0; i < n; i++)
+        t.offsets[i + 1] += t.offsets[i];
+
+      vector<size_t> next(t.offsets.begin(), t.offsets.end() - 1);
+      for(size_t node = 0; node < n; node++)
+        for(const size_t* it = a.begin(node), *end = a.end(node); it != end; it++)
+          t.targets[next[*it]++] = node;
+      return t;
+    }
+
+    /**
+     * Strongly connected components of a graph (Tarjan), iterative so that
+     * deep graphs don't overflow the stack. Components are numbered in reverse
+     * topological order of the condensation: the successors of a node are
+     * either in its own component or in one with a lower number.
+     * @param a         Successors of each node.
+     * @param component Set to the component of each node.
+     * @return Number of components.
+     */
+    inline size_t stronglyConnectedComponents(const adjacency& a, vector<size_t>& component)
+    {
+      size_t n = a.offsets.size() - 1;
+      component.assign(n, SIZE_MAX);
+      vector<size_t> number(n, SIZE_MAX);//visit number of each node
+      vector<size_t> lowlink(n);
+      vector<bool> onStack(n, false);
+      vector<size_t> stack;
+      //frames of the depth first visit, node and next edge to follow
+      vector<pair<size_t, size_t>> frames;
+      size_t visited = 0;
+      size_t components = 0;
+
+      for(size_t root = 0; root < n; root++)
+      {
+        if(number[root] != SIZE_MAX)
+          continue;
+        number[root] = lowlink[root] = visited++;
+        stack.push_back(root);
+        onStack[root] = true;
+        frames.push_back(std::make_pair(root, a.offsets[root]));
+
+        while(!frames.empty())
+        {
+          size_t v = frames.back().first;
+          if(frames.back().second < a.offsets[v + 1])
+          {
+            size_t w = a.targets[frames.back().second++];
+            if(number[w] == SIZE_MAX)
+            {
+              number[w] = lowlink[w] = visited++;
+              stack.push_back(w);
+              onStack[w] = true;
+              frames.push_back(std::make_pair(w, a.offsets[w]));
+            }
+            else if(onStack[w])
+              lowlink[v] = std::min(lowlink[v], number[w]);
+            continue;
+          }
+
+          frames.pop_back();
+          if(!frames.empty())
+          {
+            size_t u = frames.back().first;
+            lowlink[u] = std::min(lowlink[u], lowlink[v]);
+          }
+          //v is the root of a component, which is on top of the stack
+          if(lowlink[v] == number[v])
+          {
+            size_t w;
+            do
+            {
+              w = stack.back();
+              stack.pop_back();
+              onStack[w] = false;
+              component[w] = components;
+            }
+            while(w != v);
+            components++;
+          }
+        }
+      }
+      return components;
+    }
+  }
+}
+#endif
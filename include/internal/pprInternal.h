@@ -22,15 +22,16 @@ namespace ppr
   namespace pprInternal
   {
     /**
-     * Given a graph which is an unordered_map which maps nodes to
-     * a list of their direct successors get two partitions.
-     * @param graph The graph for which to find two partitions.
+     * Given a graph which is an unordered_map which maps nodes to a list of
+     * their direct successors get the transpose graph, mapping each node to
+     * a list of its direct predecessors (repeated edges are repeated).
+     * @param graph
      */
     template<typename Key>
-    inline pair<unordered_set<Key>, unordered_set<Key>> findPartitions(const unordered_map<Key, vector<Key>>& graph)
+    inline unordered_map<Key, vector<Key>> predecessorsOf(const unordered_map<Key, vector<Key>>& graph)
     {
-      //get list of predecessors for each node
       unordered_map<Key, vector<Key>> predecessors;
+      predecessors.reserve(graph.size());
       for(const auto& keyVal: graph)
       {
         const Key& node = keyVal.first;
@@ -41,6 +42,19 @@ namespace ppr
         for(const Key& v: successors)
           predecessors[v].push_back(node);
       }
+      return predecessors;
+    }
+
+    /**
+     * Given a graph which is an unordered_map which maps nodes to
+     * a list of their direct successors get two partitions.
+     * @param graph The graph for which to find two partitions.
+     */
+    template<typename Key>
+    inline pair<unordered_set<Key>, unordered_set<Key>> findPartitions(const unordered_map<Key, vector<Key>>& graph)
+    {
+      //get list of predecessors for each node
+      unordered_map<Key, vector<Key>> predecessors = predecessorsOf(graph);
 
       pair<unordered_set<Key>, unordered_set<Key>> partitions(std::make_pair(unordered_set<Key>(), unordered_set<Key>()));
 
@@ -137,6 +151,35 @@ namespace ppr
     }
 
 
+    /**
+     * Combine the maps of the successors of a node into the map of the node,
+     * adding a fraction of each score (the core of grank).
+     * @param scores     Maps of the nodes, must have a map for each successor.
+     * @param successors Successors of the node.
+     * @param factor     Fraction of the scores of the successors to add.
+     * @param map        Map of the node, updated.
+     * @return Number of entries of the maps of the successors merged.
+     */
+    template<typename Key>
+    inline size_t combineSuccessors(const unordered_map<Key, unordered_map<Key, double>>& scores,
+      const vector<Key>& successors, double factor, unordered_map<Key, double>& map)
+    {
+      size_t merged = 0;
+      for(const Key& successor: successors)
+      {
+        /**
+         * for each value of personalized pagerank (max L values) saved
+         * in the map  of a successor increment the personalized pagerank of v
+         * for that key of a fraction of it.
+         */
+         const unordered_map<Key, double>& successorMap = scores.find(successor)->second;
+         for(const auto& keyValue: successorMap)
+           map[keyValue.first] += keyValue.second * factor;
+         merged += successorMap.size();
+      }
+      return merged;
+    }
+
     /**
      * Calculate the norm1 between two unordered_maps, as if they were 2 vectors
      * where the value for unmapped elements is 0.
@@ -0,0 +1,194 @@
+#ifndef PPRRANDOM_H
+#define PPRRANDOM_H
+
+#include <cmath>
+#include <random>
+#include <stdint.h>
+#include <vector>
+
+using std::vector;
+
+namespace ppr
+{
+  namespace pprInternal
+  {
+    /**
+     * Splitmix64 step, used to expand a single 64 bit seed into the state of
+     * the xoshiro generators and to derive seeds from other seeds.
+     * @param state State of the splitmix generator, advanced by the call.
+     */
+    inline uint64_t splitmix64(uint64_t& state)
+    {
+      uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+      return z ^ (z >> 31);
+    }
+
+    /**
+     * Derive a seed from a seed and an index (i.e. the id of a node), so that
+     * independent tasks can have their own reproducible generator.
+     */
+    inline uint64_t deriveSeed(uint64_t seed, uint64_t index)
+    {
+      uint64_t state = seed ^ splitmix64(index);
+      return splitmix64(state);
+    }
+
+    /**
+     * A non deterministic seed, for when the user does not provide one.
+     */
+    inline uint64_t randomSeed()
+    {
+      std::random_device device;
+      return (static_cast<uint64_t>(device()) << 32) ^ device();
+    }
+
+    /**
+     * xoshiro256** generator (Blackman and Vigna), much faster than mt19937.
+     * Independent tasks get their own generator seeded with deriveSeed.
+     * It satisfies the UniformRandomBitGenerator requirements so it can be used
+     * with the std distributions too.
+     */
+    class xoshiro256
+    {
+      public:
+        typedef uint64_t result_type;
+
+        explicit xoshiro256(uint64_t seed = 0) { reseed(seed); }
+
+        /**
+         * Reset the state of the generator from a seed.
+         */
+        inline void reseed(uint64_t seed)
+        {
+          for(int i = 0; i < 4; i++)
+            s[i] = splitmix64(seed);
+        }
+
+        static constexpr result_type min() { return 0; }
+        static constexpr result_type max() { return UINT64_MAX; }
+
+        inline result_type operator()()
+        {
+          const uint64_t result = rotl(s[1] * 5, 7) * 9;
+          const uint64_t t = s[1] << 17;
+          s[2] ^= s[0];
+          s[3] ^= s[1];
+          s[1] ^= s[2];
+          s[0] ^= s[3];
+          s[2] ^= t;
+          s[3] = rotl(s[3], 45);
+          return result;
+        }
+
+        /**
+         * Uniform double in [0, 1), using the 53 high bits of the next number.
+         */
+        inline double nextDouble()
+        {
+          return static_cast<double>((*this)() >> 11) * (1.0 / 9007199254740992.0);
+        }
+
+      private:
+        static inline uint64_t rotl(const uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+        uint64_t s[4];
+    };
+
+    /**
+     * Four xoshiro256** generators stepped together, with the state laid out
+     * by lane so that the loop over the lanes can be vectorised (the
+     * multiplications are by constants, and become shifts and adds).
+     * Lanes are seeded from a generator, so the numbers only depend on it.
+     */
+    class xoshiro256x4
+    {
+      public:
+        static const size_t lanes = 4;
+
+        explicit xoshiro256x4(xoshiro256& generator)
+        {
+          for(size_t l = 0; l < lanes; l++)
+          {
+            uint64_t seed = generator();
+            s0[l] = splitmix64(seed); s1[l] = splitmix64(seed);
+            s2[l] = splitmix64(seed); s3[l] = splitmix64(seed);
+          }
+        }
+
+        /**
+         * Fill "out" with uniform doubles in [0, 1), n must be a multiple of lanes.
+         */
+        inline void fill(double* out, size_t n)
+        {
+          for(size_t i = 0; i < n; i += lanes)
+            for(size_t l = 0; l < lanes; l++)
+            {
+              const uint64_t result = rotl(s1[l] * 5, 7) * 9;
+              const uint64_t t = s1[l] << 17;
+              s2[l] ^= s0[l];
+              s3[l] ^= s1[l];
+              s1[l] ^= s2[l];
+              s0[l] ^= s3[l];
+              s2[l] ^= t;
+              s3[l] = rotl(s3[l], 45);
+              out[i + l] = static_cast<double>(result >> 11) * (1.0 / 9007199254740992.0);
+            }
+        }
+
+      private:
+        static inline uint64_t rotl(const uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+        uint64_t s0[lanes], s1[lanes], s2[lanes], s3[lanes];
+    };
+
+    /**
+     * Sampler of the number of edges traversed by a random walk which always
+     * traverses the first edge and after each edge keeps going with probability
+     * "damping", that is 1 + a geometric variable: P(length = k) =
+     * damping^(k - 1) * (1 - damping). A single uniform number is needed for
+     * the whole walk instead of one for each step.
+     * With a damping of 1 walks never stop on their own (max size_t is returned).
+     */
+    class walkLength
+    {
+      public:
+        walkLength(xoshiro256& generator, double damping): uniform(generator), next(size),
+          logDamping(std::log(damping)), infinite(damping >= 1.0), single(damping <= 0.0) {}
+
+        inline size_t operator()()
+        {
+          if(infinite)
+            return SIZE_MAX;
+          if(single)
+            return 1;
+          if(next == size)
+            refill();
+          return lengths[next++];
+        }
+
+      private:
+        static const size_t size = 64;
+
+        //a block of lengths at a time, so that both the generator and the logs run in tight loops
+        inline void refill()
+        {
+          double u[size];
+          uniform.fill(u, size);
+          for(size_t i = 0; i < size; i++)
+            //1 - u is in (0, 1], so the log is finite
+            lengths[i] = 1 + static_cast<size_t>(std::log(1.0 - u[i]) / logDamping);
+          next = 0;
+        }
+
+        xoshiro256x4 uniform;
+        size_t lengths[size];
+        size_t next;
+        double logDamping;
+        bool infinite;
+        bool single;
+    };
+  }
+}
+#endif
@@ -1,22 +1,165 @@
 #ifndef PPRSINGLESOURCE_H
 #define PPRSINGLESOURCE_H
 
+#include <algorithm>//fill
+#include <cmath>//abs
+#include <stdint.h>
 #include <stdlib.h>//exit
 #include <unordered_map>
+#include <utility>//pair
+#include <vector>
 
+#include <internal/pprGraph.h>
 #include <internal/pprInternal.h>
 
 using std::cout; using std::endl; using std::cerr;
+using std::pair;
 using std::queue;
 using std::unordered_map;
 using std::unordered_set;
+using std::vector;
 
 namespace ppr
 {
   namespace pprInternal
   {
+    //scores switch from a map to dense vectors once the reached nodes are at
+    //least 1 / denseSwitch of the graph
+    const size_t denseSwitch = 16;
+
+    //sources whose scores are computed together by pprMultiSource (at most 64)
+    const size_t batchSize = 8;
+
+    //successors of a node, as a range
+    template<typename Key>
+    inline pair<const Key*, const Key*> successorRange(const unordered_map<Key, vector<Key>>& graph, const Key& node)
+    {
+      const vector<Key>& successors = graph.find(node)->second;
+      return std::make_pair(successors.data(), successors.data() + successors.size());
+    }
+
+    inline pair<const size_t*, const size_t*> successorRange(const adjacency& graph, size_t node)
+    {
+      return std::make_pair(graph.begin(node), graph.end(node));
+    }
+
+    /**
+     * Power iterations with the scores in a map, while only a few nodes are
+     * reached (see pprSingleSource).
+     * @param graph      Graph, either keyed or a dense adjacency.
+     * @param n          Nodes of the graph.
+     * @param source
+     * @param iterations Max number of iterations to run.
+     * @param damping
+     * @param tolerance
+     * @param scores     Scores, updated.
+     * @param diff       Norm-1 of the last iteration, updated.
+     * @return Number of iterations run.
+     */
+    template<typename Graph, typename Node>
+    size_t sparseIterations(const Graph& graph, size_t n, const Node& source, size_t iterations, double damping,
+      double tolerance, unordered_map<Node, double>& scores, double& diff)
+    {
+      unordered_map<Node, double> nextScores;
+      size_t i = 0;
+      for(; i < iterations && diff >= tolerance && scores.size() * denseSwitch < n; i++)
+      {
+        //clear the map and set the score of the source at the teleport contribution
+        nextScores.clear();
+        nextScores[source] = 1.0 - damping;
+
+        //move score from each node towards its children
+        for(const auto& keyVal: scores)
+        {
+          auto successors = successorRange(graph, keyVal.first);
+          double factor = damping * keyVal.second / (successors.second - successors.first);
+
+          for(auto it = successors.first; it != successors.second; it++)
+            nextScores[*it] += factor;
+        }
+
+        //check if the norm1 of the difference is greater than the maxDiff
+        diff = norm1(scores, nextScores);
+
+        scores.swap(nextScores);
+      }
+      return i;
+    }
+
+    /**
+     * Power iterations with the scores in dense vectors, going only over the
+     * nodes reached so far (the active list, which grows as the scores
+     * spread), for when a good part of the graph is reached.
+     * @param graph      Dense copy of the graph.
+     * @param source     Id of the source.
+     * @param iterations Max number of iterations to run.
+     * @param damping
+     * @param tolerance
+     * @param start      Scores to start from, by id, the source must be there.
+     * @param diff       Norm-1 of the last iteration.
+     * @return The scores, of the reached nodes.
+     */
+    template<typename Key>
+    unordered_map<Key, double> denseIterations(const denseGraph<Key>& graph, size_t source, size_t iterations,
+      double damping, double tolerance, const unordered_map<size_t, double>& start, double diff)
+    {
+      const adjacency& successors = graph.successors;
+      size_t n = graph.size();
+      vector<double> scores(n, 0.0);
+      vector<double> nextScores(n, 0.0);
+      vector<size_t> active;
+      vector<char> reached(n, 0);
+      active.reserve(start.size());
+      for(const auto& keyVal: start)
+      {
+        scores[keyVal.first] = keyVal.second;
+        reached[keyVal.first] = 1;
+        active.push_back(keyVal.first);
+      }
+
+      for(size_t i = 0; i < iterations && diff >= tolerance; i++)
+      {
+        nextScores[source] = 1.0 - damping;
+
+        //nodes reached in this iteration are appended to the list, their score
+        //is 0 so they have nothing to move yet
+        for(size_t a = 0, aEnd = active.size(); a < aEnd; a++)
+        {
+          size_t father = active[a];
+          double factor = damping * scores[father] / successors.degree(father);
+          for(const size_t* it = successors.begin(father), *end = successors.end(father); it != end; it++)
+          {
+            nextScores[*it] += factor;
+            if(!reached[*it])
+            {
+              reached[*it] = 1;
+              active.push_back(*it);
+            }
+          }
+        }
+
+        diff = 0;
+        for(size_t node: active)
+        {
+          diff += std::abs(scores[node] - nextScores[node]);
+          scores[node] = nextScores[node];
+          nextScores[node] = 0;
+        }
+      }
+
+      unordered_map<Key, double> res;
+      res.reserve(active.size());
+      for(size_t node: active)
+        res.insert(std::make_pair(graph.keys[node], scores[node]));
+      return res;
+    }
+
     /**
      * Returns the personalized Pagerank of a single source node.
+     * Scores are kept in a map while they reach a few nodes, and move to dense
+     * vectors (building a dense copy of the graph) once they reach a good part
+     * of it, like direction optimizing BFS switches between top-down and
+     * bottom-up.
      * @param graph
      * @param iterations Max number of iterations to run.
      * @param damping    Pagerank damping factor;
@@ -40,38 +183,159 @@ namespace ppr
         //it to a negative number
 
         unordered_map<Key, double> scores;
-        unordered_map<Key, double> nextScores;
 
         //init the source node has having a score of 1
         scores[source] = 1.0;
 
         double diff = tolerance;
-        for(size_t i = 0; i < iterations && diff >= tolerance; i++)
+        size_t done = sparseIterations(graph, graph.size(), source, iterations, damping, tolerance, scores, diff);
+        if(done == iterations || diff < tolerance)
+          return scores;
+
+        denseGraph<Key> dense = makeDenseGraph(graph);
+        unordered_map<size_t, double> start;
+        start.reserve(scores.size());
+        for(const auto& keyVal: scores)
+          start.insert(std::make_pair(dense.ids.find(keyVal.first)->second, keyVal.second));
+        return denseIterations(dense, dense.ids.find(source)->second, iterations - done, damping, tolerance,
+          start, diff);
+      }
+
+    /**
+     * Same as above, on a dense copy of the graph built once for many sources.
+     * @param graph
+     * @param iterations Max number of iterations to run.
+     * @param damping    Pagerank damping factor;
+     * @param tolerance  Stopping tolerance, see above.
+     * @param source     Id of the node for which to calculate the ppr.
+     */
+    template<typename Key>
+    unordered_map<Key, double> pprSingleSource(const denseGraph<Key>& graph, //the graph
+      size_t iterations,//max number of iterations
+      double damping,//damping factor
+      double tolerance,//tolerance
+      size_t source)//id of the source node for which ppr is going to be computed
+      {
+        //checking parameters
+        if(iterations == 0){cerr << "iterations must be positive" << endl; exit(EXIT_FAILURE);}
+        if(damping < 0 || damping > 1){cerr << "damping must be [0,1]" << endl; exit(EXIT_FAILURE);}
+        if(source >= graph.size()){cerr << "source node not part of the graph" << endl; exit(EXIT_FAILURE);}
+
+        unordered_map<size_t, double> scores;
+        scores[source] = 1.0;
+
+        double diff = tolerance;
+        size_t done = sparseIterations(graph.successors, graph.size(), source, iterations, damping, tolerance,
+          scores, diff);
+        if(done == iterations || diff < tolerance)
+        {
+          unordered_map<Key, double> res;
+          res.reserve(scores.size());
+          for(const auto& keyVal: scores)
+            res.insert(std::make_pair(graph.keys[keyVal.first], keyVal.second));
+          return res;
+        }
+        return denseIterations(graph, source, iterations - done, damping, tolerance, scores, diff);
+      }
+
+    /**
+     * Personalized Pagerank of many sources, the same as running pprSingleSource
+     * for each of them (with the same stopping rule for each source), but
+     * batchSize sources at a time: their scores are the columns of an n x
+     * batchSize block, laid out by node, so that a single scan of the edges
+     * per iteration moves the scores of the whole batch and the loop over the
+     * batch is vectorised.
+     * @param graph      Dense copy of the graph.
+     * @param sources    Ids of the sources (repetitions allowed).
+     * @param iterations Max number of iterations to run.
+     * @param damping    Pagerank damping factor;
+     * @param tolerance  Stopping tolerance, see pprSingleSource.
+     * @return The scores of each source, in the order of "sources".
+     */
+    template<typename Key>
+    vector<unordered_map<Key, double>> pprMultiSource(const denseGraph<Key>& graph, //the graph
+      const vector<size_t>& sources,//ids of the sources
+      size_t iterations,//max number of iterations
+      double damping,//damping factor
+      double tolerance)//tolerance
+      {
+        //checking parameters
+        if(iterations == 0){cerr << "iterations must be positive" << endl; exit(EXIT_FAILURE);}
+        if(damping < 0 || damping > 1){cerr << "damping must be [0,1]" << endl; exit(EXIT_FAILURE);}
+        for(size_t source: sources)
+          if(source >= graph.size()){cerr << "source node not part of the graph" << endl; exit(EXIT_FAILURE);}
+
+        const adjacency& successors = graph.successors;
+        size_t n = graph.size();
+        vector<unordered_map<Key, double>> res(sources.size());
+        vector<double> scores(n * batchSize);
+        vector<double> nextScores(n * batchSize);
+        //bit b of a node is set once the node is reached by the scores of source b
+        vector<uint64_t> reached(n);
+        vector<uint64_t> nextReached(n);
+
+        for(size_t first = 0; first < sources.size(); first += batchSize)
         {
-            diff = 0;
-            //clear the map and set the score of the source at the teleport contribution
-            nextScores.clear();
-            nextScores[source] = 1.0 - damping;
+          size_t batch = std::min(batchSize, sources.size() - first);
+          std::fill(scores.begin(), scores.end(), 0.0);
+          std::fill(reached.begin(), reached.end(), 0);
+          for(size_t b = 0; b < batch; b++)
+          {
+            scores[sources[first + b] * batchSize + b] = 1.0;
+            reached[sources[first + b]] |= uint64_t(1) << b;
+          }
+
+          //columns still iterating, the unused ones of the last batch never are
+          uint64_t running = (batch == 64)? ~uint64_t(0) : (uint64_t(1) << batch) - 1;
+          for(size_t i = 0; i < iterations && running; i++)
+          {
+            std::fill(nextScores.begin(), nextScores.end(), 0.0);
+            nextReached = reached;
+            for(size_t b = 0; b < batch; b++)
+              nextScores[sources[first + b] * batchSize + b] = 1.0 - damping;
 
             //move score from each node towards its children
-            for(const auto& keyVal: scores)
+            for(size_t father = 0; father < n; father++)
             {
-              const Key& father = keyVal.first;
-              const double score = keyVal.second;
-              const vector<Key>& successors = graph.find(father)->second;
-              double factor = damping/successors.size();
-
-              for(const Key& successor : successors)
-                nextScores[successor] += score * factor;
+              size_t degree = successors.degree(father);
+              if(reached[father] == 0 || degree == 0)
+                continue;
+              double factor[batchSize];
+              const double* row = scores.data() + father * batchSize;
+              for(size_t b = 0; b < batchSize; b++)
+                factor[b] = damping * row[b] / degree;
+              for(const size_t* it = successors.begin(father), *end = successors.end(father); it != end; it++)
+              {
+                double* next = nextScores.data() + *it * batchSize;
+                for(size_t b = 0; b < batchSize; b++)
+                  next[b] += factor[b];
+                nextReached[*it] |= reached[father];
+              }
             }
 
-            //check if the norm1 of the difference is greater than the maxDiff
-            diff = ppr::pprInternal::norm1(scores, nextScores);
+            //norm1 of the difference of each column
+            double diff[batchSize] = {};
+            for(size_t node = 0; node < n; node++)
+              for(size_t b = 0; b < batchSize; b++)
+                diff[b] += std::abs(scores[node * batchSize + b] - nextScores[node * batchSize + b]);
 
             scores.swap(nextScores);
-        }
+            reached.swap(nextReached);
 
-        return scores;
+            //columns which are done get their map, the ones of the other columns
+            //are taken once they are done too
+            for(size_t b = 0; b < batch; b++)
+              if(((running >> b) & 1) && (diff[b] < tolerance || i + 1 == iterations))
+              {
+                running &= ~(uint64_t(1) << b);
+                unordered_map<Key, double>& map = res[first + b];
+                for(size_t node = 0; node < n; node++)
+                  if((reached[node] >> b) & 1)
+                    map.insert(std::make_pair(graph.keys[node], scores[node * batchSize + b]));
+              }
+          }
+        }
+        return res;
       }
   }
 }
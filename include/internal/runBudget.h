@@ -0,0 +1,77 @@
+#ifndef RUNBUDGET_H
+#define RUNBUDGET_H
+
+#include <atomic>
+#include <chrono>
+
+namespace ppr
+{
+  /**
+   * Cancellation token and wall clock deadline of a run of grank, grankMulti,
+   * mccompletepathv2 or mccompletepathv2Multi. The algorithms check it between
+   * iterations and every few nodes, once it has expired they stop and return
+   * the maps they have so far (their current top-L truncated to K).
+   * cancel() can be called from any thread while the run goes on, the deadline
+   * must be set before the run.
+   */
+  class runBudget
+  {
+    public:
+      runBudget() : cancelled(false), stopped(false), deadline(std::chrono::steady_clock::time_point::max()) {}
+
+      /**
+       * @param seconds Time from now after which the budget expires.
+       */
+      explicit runBudget(double seconds) : runBudget()
+      {
+        setTimeout(seconds);
+      }
+
+      void cancel() { cancelled.store(true, std::memory_order_relaxed); }
+
+      void setDeadline(std::chrono::steady_clock::time_point at) { deadline = at; }
+
+      void setTimeout(double seconds)
+      {
+        deadline = std::chrono::steady_clock::now() +
+          std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds));
+      }
+
+      //true once cancelled or past the deadline
+      bool expired() const
+      {
+        return cancelled.load(std::memory_order_relaxed) || std::chrono::steady_clock::now() >= deadline;
+      }
+
+      //true if a run using the budget stopped before finishing its work
+      bool stoppedEarly() const { return stopped.load(std::memory_order_relaxed); }
+
+      //called by the algorithms when they stop because the budget expired
+      void markStopped() { stopped.store(true, std::memory_order_relaxed); }
+
+    private:
+      std::atomic<bool> cancelled;
+      std::atomic<bool> stopped;
+      std::chrono::steady_clock::time_point deadline;
+  };
+
+  namespace pprInternal
+  {
+    //nodes done between two checks of the budget, reading the clock for every
+    //node would cost more than the work on a node of a sparse graph
+    const size_t budgetCheck = 256;
+
+    /**
+     * True if the budget (if any) expired, checked every budgetCheck calls
+     * counted by "done", marking the budget as stopped.
+     */
+    inline bool budgetExpired(runBudget* budget, size_t done)
+    {
+      if(budget == nullptr || done % budgetCheck != 0 || !budget->expired())
+        return false;
+      budget->markStopped();
+      return true;
+    }
+  }
+}
+#endif
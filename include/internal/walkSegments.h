@@ -0,0 +1,264 @@
+#ifndef WALKSEGMENTS_H
+#define WALKSEGMENTS_H
+
+#include <algorithm>//sort
+#include <fstream>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <internal/pprGraph.h>
+#include <internal/pprRandom.h>
+
+using std::string;
+using std::vector;
+
+namespace ppr
+{
+  namespace pprInternal
+  {
+    //padding of a segment after the dead end where it stopped
+    const size_t segmentEnd = SIZE_MAX;
+
+    /**
+     * Precomputed random walk segments (walk stitching, as in Bahmani et al.
+     * and FAST-PPR): a few segments of a fixed number of edges for the nodes
+     * passed through the most (by in-degree), so that a walk getting to one
+     * of them with at least that many edges left can splice a segment in
+     * instead of stepping edge by edge.
+     * Segment i of node u is nodes[(offsets[u] + i) * length, ...), the nodes
+     * visited after u, padded with segmentEnd if the segment got to a node
+     * without successors.
+     */
+    struct walkSegments
+    {
+      size_t length = 0;//edges of each segment
+      size_t perNode = 0;//segments of each node with segments
+      size_t memoryCap = 0;//max bytes of the segments and their offsets, 0 for no limit
+      uint64_t graph = 0;//fingerprint of the graph
+      vector<size_t> offsets;//first segment of each node
+      vector<size_t> nodes;
+
+      inline size_t count(size_t node) const { return offsets[node + 1] - offsets[node]; }
+      inline const size_t* segment(size_t node, size_t i) const { return nodes.data() + (offsets[node] + i) * length; }
+
+      /**
+       * Save the segments to a file (native byte order), false on failure.
+       */
+      bool save(const string& path) const
+      {
+        std::ofstream out(path, std::ios::binary);
+        if(!out)
+          return false;
+        uint64_t header[] = {magic, graph, offsets.size() - 1, length, perNode, memoryCap, nodes.size()};
+        out.write(reinterpret_cast<const char*>(header), sizeof(header));
+        writeWords(out, offsets);
+        writeWords(out, nodes);
+        return static_cast<bool>(out);
+      }
+
+      /**
+       * Load segments saved for the same graph and with the same parameters,
+       * false (leaving the segments untouched) if there is no such file or if
+       * it is not consistent (offsets not increasing, more than perNode segments
+       * for a node, nodes out of the graph or segments going on after their end).
+       * @param path
+       * @param graph     Fingerprint of the graph.
+       * @param n         Nodes of the graph.
+       * @param length    Edges of each segment.
+       * @param perNode   Segments of each node with segments.
+       * @param memoryCap Max bytes of the segments.
+       */
+      bool load(const string& path, uint64_t graph, size_t n, size_t length, size_t perNode, size_t memoryCap)
+      {
+        std::ifstream in(path, std::ios::binary);
+        if(!in)
+          return false;
+        uint64_t header[7];
+        in.read(reinterpret_cast<char*>(header), sizeof(header));
+        if(!in || header[0] != magic || header[1] != graph || header[2] != n || header[3] != length ||
+          header[4] != perNode || header[5] != memoryCap)
+          return false;
+
+        vector<size_t> newOffsets(n + 1);
+        if(!readWords(in, newOffsets) || newOffsets[0] != 0)
+          return false;
+        for(size_t u = 0; u < n; u++)
+          if(newOffsets[u + 1] < newOffsets[u] || newOffsets[u + 1] - newOffsets[u] > perNode)
+            return false;
+        //checked before allocating the nodes, the count in the header could be anything
+        if(length == 0 || header[6] != newOffsets[n] * length)
+          return false;
+        vector<size_t> newNodes(header[6]);
+        if(!readWords(in, newNodes))
+          return false;
+        for(size_t i = 0; i < newNodes.size(); i++)
+        {
+          //segments take at least a step, and once padded they stay padded
+          bool first = i % length == 0;
+          bool afterEnd = !first && newNodes[i - 1] == segmentEnd;
+          bool valid = afterEnd? newNodes[i] == segmentEnd : newNodes[i] < n || (!first && newNodes[i] == segmentEnd);
+          if(!valid)
+            return false;
+        }
+        this->graph = graph; this->length = length; this->perNode = perNode; this->memoryCap = memoryCap;
+        offsets.swap(newOffsets);
+        nodes.swap(newNodes);
+        return true;
+      }
+
+      private:
+        static const uint64_t magic = 0x31474553525050ULL;//"PPRSEG1"
+
+        static void writeWords(std::ofstream& out, const vector<size_t>& words)
+        {
+          for(size_t word: words)
+          {
+            uint64_t w = (word == SIZE_MAX)? UINT64_MAX : word;
+            out.write(reinterpret_cast<const char*>(&w), sizeof(w));
+          }
+        }
+
+        static bool readWords(std::ifstream& in, vector<size_t>& words)
+        {
+          for(size_t& word: words)
+          {
+            uint64_t w;
+            if(!in.read(reinterpret_cast<char*>(&w), sizeof(w)))
+              return false;
+            word = (w == UINT64_MAX)? SIZE_MAX : static_cast<size_t>(w);
+          }
+          return true;
+        }
+    };
+
+    /**
+     * Build the segments of a graph: nodes are taken by decreasing in-degree
+     * (ties by id), each with "perNode" segments, until the memory cap is hit
+     * (the cap covers the offsets of the nodes and the counters of segmentReader
+     * too, so a cap below them leaves no segments).
+     * Successors are picked at random, independently for each segment.
+     * @param graph     Dense copy of the graph.
+     * @param length    Edges of each segment (at least one).
+     * @param perNode   Segments of each node.
+     * @param memoryCap Max bytes of the segments, 0 for no limit.
+     * @param seed      Seed of the segments.
+     */
+    template<typename Key>
+    walkSegments buildSegments(const denseGraph<Key>& graph, size_t length, size_t perNode,
+      size_t memoryCap, uint64_t seed)
+    {
+      const adjacency& successors = graph.successors;
+      size_t n = graph.size();
+      walkSegments segments;
+      segments.length = length;
+      segments.perNode = perNode;
+      segments.memoryCap = memoryCap;
+      segments.graph = fingerprint(graph);
+
+      vector<size_t> indegree(n, 0);
+      for(size_t target: successors.targets)
+        indegree[target]++;
+      vector<size_t> hubs;
+      for(size_t u = 0; u < n; u++)
+        if(successors.degree(u) > 0)
+          hubs.push_back(u);
+      std::sort(hubs.begin(), hubs.end(), [&indegree](size_t u, size_t v)
+        { return indegree[u] > indegree[v] || (indegree[u] == indegree[v] && u < v);});
+
+      size_t maxSegments = hubs.size() * perNode;
+      if(memoryCap > 0 && length > 0)
+      {
+        //the offsets and the segments used of each node (see segmentReader)
+        //are there whatever the segments, the rest of the cap goes to them
+        size_t fixed = (2 * n + 1) * sizeof(size_t);
+        maxSegments = (memoryCap > fixed)? std::min(maxSegments, (memoryCap - fixed) / (length * sizeof(size_t))) : 0;
+      }
+      hubs.resize((perNode == 0)? 0 : maxSegments / perNode);
+
+      //segments of each node, then summed into the offsets
+      segments.offsets.assign(n + 1, 0);
+      for(size_t u: hubs)
+        segments.offsets[u + 1] = perNode;
+      for(size_t u = 0; u < n; u++)
+        segments.offsets[u + 1] += segments.offsets[u];
+
+      xoshiro256 generator(seed);
+      segments.nodes.assign(segments.offsets[n] * length, segmentEnd);
+      for(size_t u = 0; u < n; u++)
+        for(size_t i = 0; i < segments.count(u); i++)
+        {
+          size_t* segment = segments.nodes.data() + (segments.offsets[u] + i) * length;
+          size_t current = u;
+          for(size_t step = 0; step < length && successors.degree(current) > 0; step++)
+          {
+            current = successors.begin(current)[generator() % successors.degree(current)];
+            segment[step] = current;
+          }
+        }
+      return segments;
+    }
+
+    /**
+     * Hands out the segments of each node once, so that the walks of a source
+     * never use the same segment twice (walks of different sources do).
+     * The number of segments used of each node is kept in a dense array of the
+     * size of the graph, provided by the caller (all zeros) so that it can be
+     * reused; reset() leaves it as it was found.
+     */
+    class segmentReader
+    {
+      public:
+        /**
+         * @param segments
+         * @param used     Segments used of each node, all zeros; shared scratch.
+         */
+        segmentReader(const walkSegments& segments, vector<size_t>& used): segments(segments),
+          used(used), spliced(0) {}
+
+        ~segmentReader() { reset(); }
+
+        segmentReader(const segmentReader&) = delete;
+        segmentReader& operator=(const segmentReader&) = delete;
+
+        inline size_t length() const { return segments.length; }
+
+        /**
+         * Next unused segment of a node, nullptr if there is none.
+         */
+        inline const size_t* take(size_t node)
+        {
+          size_t i = used[node];
+          if(i >= segments.count(node))
+            return nullptr;
+          if(i == 0)
+            touched.push_back(node);
+          used[node]++;
+          spliced++;
+          return segments.segment(node, i);
+        }
+
+        /**
+         * Segments handed out since the reader was built.
+         */
+        inline size_t splicedSegments() const { return spliced; }
+
+        /**
+         * Make every segment available again.
+         */
+        inline void reset()
+        {
+          for(size_t node: touched)
+            used[node] = 0;
+          touched.clear();
+        }
+
+      private:
+        const walkSegments& segments;
+        vector<size_t>& used;
+        vector<size_t> touched;
+        size_t spliced;
+    };
+  }
+}
+#endif
@@ -0,0 +1,327 @@
+#ifndef MCINCREMENTAL_H
+#define MCINCREMENTAL_H
+
+#include <algorithm>//find
+#include <iostream>
+#include <stdint.h>
+#include <stdlib.h>//exit
+#include <unordered_map>
+#include <utility>//make pair
+#include <vector>
+
+#include <internal/pprInternal.h>
+#include <internal/pprRandom.h>
+
+using std::cerr; using std::endl;
+using std::make_pair;
+using std::unordered_map;
+using std::vector;
+
+using ppr::pprInternal::keepTop;
+using ppr::pprInternal::xoshiro256;
+
+namespace ppr
+{
+  /**
+   * Monte Carlo personalized pagerank kept up to date under edge insertions and
+   * deletions (Bahmani, Chowdhury, Goel, "Fast incremental and personalized
+   * PageRank"). Every node stores a number of random walks (after each visit a
+   * walk goes on with probability "damping" to a successor picked at random,
+   * and stops in nodes without successors), and every node knows which walks
+   * pass through it. When an edge u -> v is inserted each walk leaving u takes
+   * the new edge with probability 1 / outdegree(u) and is walked again from
+   * there, when it is deleted the walks which took it are walked again from u,
+   * so the walks are always distributed as if they were walked on the current
+   * graph, and the work of an update is proportional to the walks passing
+   * through u, not to the size of the graph.
+   * Scores are in the same unit of mccompletepathv2, expected visits of a walk
+   * from the source (multiply by 1 - damping to get pagerank).
+   */
+  template<typename Key>
+  class mcIncremental
+  {
+    public:
+      /**
+       * @param graph   Starting graph, every node must be a key of the map.
+       * @param walks   Walks stored for each node.
+       * @param damping Probability of going on after each visit, [0, 1).
+       * @param seed    Seed of the walks.
+       */
+      mcIncremental(const unordered_map<Key, vector<Key>>& graph, //the graph
+      size_t walks,//walks of each node
+      double damping,//damping factor
+      uint64_t seed)//seed of the random walks
+        : walksPerNode(walks), damping(damping), generator(seed), epoch(0), rerouted(0)
+      {
+        if(walks == 0){cerr << "walks must be positive" << endl; exit(EXIT_FAILURE);}
+        if(damping < 0 || damping >= 1){cerr << "damping must be [0,1)" << endl; exit(EXIT_FAILURE);}
+
+        keys.reserve(graph.size());
+        ids.reserve(graph.size());
+        for(const auto& keyVal: graph)
+          addNode(keyVal.first, false);
+        for(const auto& keyVal: graph)
+          for(const Key& v: keyVal.second)
+            successors[ids.find(keyVal.first)->second].push_back(ids.find(v)->second);
+        for(size_t u = 0; u < keys.size(); u++)
+          startWalks(u);
+      }
+
+      /**
+       * Insert the edge u -> v (nodes which are not in the graph yet are added,
+       * with their walks), rerouting the walks leaving u.
+       */
+      void insertEdge(const Key& u, const Key& v)
+      {
+        size_t from = addNode(u, true);
+        size_t to = addNode(v, true);
+        successors[from].push_back(to);
+        size_t degree = successors[from].size();
+
+        for(const visit& at: validVisits(from))
+        {
+          walk& w = walks[at.walk];
+          if(!isValid(at))
+            continue;
+          bool last = at.position + 1 == w.nodes.size();
+          //walks which stopped in u because it had no successors go on now, the
+          //others take the new edge with probability 1 / degree
+          if(!(last && w.dangling) && (last || generator() % degree != 0))
+            continue;
+          truncate(at.walk, at.position);
+          epoch++;
+          append(at.walk, to);
+          extend(at.walk);
+          rerouted++;
+        }
+      }
+
+      /**
+       * Delete the edge u -> v (one of its copies if it is repeated), rerouting
+       * the walks which took it.
+       * @return False if there is no such edge.
+       */
+      bool removeEdge(const Key& u, const Key& v)
+      {
+        auto itU = ids.find(u);
+        auto itV = ids.find(v);
+        if(itU == ids.end() || itV == ids.end())
+          return false;
+        size_t from = itU->second;
+        size_t to = itV->second;
+        vector<size_t>& out = successors[from];
+        auto edge = std::find(out.begin(), out.end(), to);
+        if(edge == out.end())
+          return false;
+        //walks took one of the copies of the edge, the deleted one with probability 1 / copies
+        size_t copies = std::count(out.begin(), out.end(), to);
+        out.erase(edge);
+
+        for(const visit& at: validVisits(from))
+        {
+          walk& w = walks[at.walk];
+          if(!isValid(at) || at.position + 1 == w.nodes.size() || w.nodes[at.position + 1] != to ||
+            generator() % copies != 0)
+            continue;
+          truncate(at.walk, at.position);
+          epoch++;
+          if(out.empty())
+            w.dangling = true;
+          else
+          {
+            append(at.walk, out[generator() % out.size()]);
+            extend(at.walk);
+          }
+          rerouted++;
+        }
+        return true;
+      }
+
+      /**
+       * Top-K scores of a source, empty if the source is not in the graph.
+       */
+      unordered_map<Key, double> scores(const Key& source, size_t K) const
+      {
+        unordered_map<Key, double> res;
+        auto it = ids.find(source);
+        if(it == ids.end())
+          return res;
+        unordered_map<size_t, double> map(counts[it->second].begin(), counts[it->second].end());
+        keepTop(K, map);
+        res.reserve(map.size());
+        for(const auto& keyVal: map)
+          res.insert(make_pair(keys[keyVal.first], keyVal.second / walksPerNode));
+        return res;
+      }
+
+      /**
+       * Top-K scores of every node.
+       */
+      unordered_map<Key, unordered_map<Key, double>> scores(size_t K) const
+      {
+        unordered_map<Key, unordered_map<Key, double>> res; res.reserve(keys.size());
+        for(const Key& key: keys)
+          res[key] = scores(key, K);
+        return res;
+      }
+
+      /**
+       * Walks rerouted by the updates so far.
+       */
+      size_t reroutedWalks() const { return rerouted; }
+
+      /**
+       * Visits stored to find the walks passing through a node, the stale ones
+       * left by rerouted walks included; they are compacted so that this stays
+       * under twice the visits of the walks.
+       */
+      size_t storedVisits() const
+      {
+        size_t stored = 0;
+        for(const vector<visit>& list: visits)
+          stored += list.size();
+        return stored;
+      }
+
+    private:
+      struct walk
+      {
+        size_t source;
+        vector<size_t> nodes;
+        vector<uint64_t> epochs;//epoch in which each node has been walked
+        bool dangling;//stopped in a node without successors, and not by the damping
+      };
+
+      //a walk being in a node, valid while that part of the walk is not walked again
+      struct visit
+      {
+        size_t walk;
+        size_t position;
+        uint64_t epoch;
+      };
+
+      inline bool isValid(const visit& at) const
+      {
+        const walk& w = walks[at.walk];
+        return at.position < w.nodes.size() && w.epochs[at.position] == at.epoch;
+      }
+
+      //id of a node, added if it is new (starting its walks if "walk" is true)
+      size_t addNode(const Key& key, bool walk)
+      {
+        auto it = ids.find(key);
+        if(it != ids.end())
+          return it->second;
+        size_t id = keys.size();
+        ids.insert(make_pair(key, id));
+        keys.push_back(key);
+        successors.emplace_back();
+        visits.emplace_back();
+        stale.push_back(0);
+        counts.emplace_back();
+        if(walk)
+          startWalks(id);
+        return id;
+      }
+
+      void startWalks(size_t source)
+      {
+        for(size_t i = 0; i < walksPerNode; i++)
+        {
+          size_t id = walks.size();
+          walks.push_back(walk{source, {}, {}, false});
+          epoch++;
+          append(id, source);
+          extend(id);
+        }
+      }
+
+      void append(size_t id, size_t node)
+      {
+        walk& w = walks[id];
+        visits[node].push_back(visit{id, w.nodes.size(), epoch});
+        w.nodes.push_back(node);
+        w.epochs.push_back(epoch);
+        counts[w.source][node]++;
+      }
+
+      //go on walking from the last node of a walk
+      void extend(size_t id)
+      {
+        walk& w = walks[id];
+        while(true)
+        {
+          //the walk decides to go on first, so that a dangling walk is one
+          //which would have gone on and it takes the first edge added to its last node
+          if(generator.nextDouble() >= damping)
+          {
+            w.dangling = false;
+            return;
+          }
+          const vector<size_t>& out = successors[w.nodes.back()];
+          if(out.empty())
+          {
+            w.dangling = true;
+            return;
+          }
+          append(id, out[generator() % out.size()]);
+        }
+      }
+
+      //drop the part of a walk after a position
+      void truncate(size_t id, size_t position)
+      {
+        walk& w = walks[id];
+        unordered_map<size_t, size_t>& count = counts[w.source];
+        //from the end, so that the visits dropped are not valid anymore if the list is compacted
+        while(w.nodes.size() > position + 1)
+        {
+          size_t node = w.nodes.back();
+          w.nodes.pop_back();
+          w.epochs.pop_back();
+          auto it = count.find(node);
+          if(--it->second == 0)
+            count.erase(it);
+          //nodes downstream of an update may never be updated themselves, so
+          //their lists are compacted here once they are mostly stale
+          if(++stale[node] > visits[node].size() - stale[node])
+            compact(node);
+        }
+        w.dangling = false;
+      }
+
+      //drop the stale visits from the list of a node
+      void compact(size_t node)
+      {
+        vector<visit>& list = visits[node];
+        size_t valid = 0;
+        for(const visit& at: list)
+          if(isValid(at))
+            list[valid++] = at;
+        list.resize(valid);
+        stale[node] = 0;
+      }
+
+      //valid visits of a node
+      vector<visit> validVisits(size_t node)
+      {
+        compact(node);
+        return visits[node];
+      }
+
+      size_t walksPerNode;
+      double damping;
+      xoshiro256 generator;
+      uint64_t epoch;
+      size_t rerouted;
+
+      vector<Key> keys;//id -> node
+      unordered_map<Key, size_t> ids;//node -> id
+      vector<vector<size_t>> successors;
+      vector<walk> walks;
+      vector<vector<visit>> visits;//visits of the walks to each node
+      vector<size_t> stale;//visits of each node which are not valid anymore
+      vector<unordered_map<size_t, size_t>> counts;//visits of the walks of each source
+  };
+}
+#endif
@@ -2,13 +2,25 @@
 #define MCCOMPLETEPATHV2_H
 
 #include <algorithm>//max
-#include <random>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <memory>//unique_ptr
+#include <mutex>
 #include <stdlib.h>//exit
+#include <string>
+#include <thread>
 #include <unordered_set>
 #include <utility>//make pair
 #include <vector>
 
+#include <internal/heavyHitters.h>
+#include <internal/memoryAccounting.h>
+#include <internal/pprGraph.h>
 #include <internal/pprInternal.h>
+#include <internal/pprRandom.h>
+#include <internal/runBudget.h>
+#include <internal/walkSegments.h>
 
 using std::cerr; using std::endl;
 using std::get;
@@ -21,148 +33,543 @@ using std::unordered_map;
 using std::unordered_set;
 using std::vector;
 
+using ppr::pprInternal::denseGraph;
 using ppr::pprInternal::findPartitions;
 using ppr::pprInternal::keepTop;
 using ppr::pprInternal::norm1;
+using ppr::pprInternal::segmentReader;
+using ppr::pprInternal::spaceSaving;
+using ppr::pprInternal::xoshiro256;
 
 namespace ppr
 {
-  namespace pprInternal
+  /**
+   * Adaptive walk budget for mccompletepathv2: the walks of a node are done in
+   * rounds, and stop as soon as its top-K is stable (same nodes in the same
+   * order for a number of rounds in a row) or the count of the K-th node is
+   * far enough from the (K+1)-th one, instead of always doing all of them.
+   */
+  struct mcAdaptive
   {
-    std::random_device pprDevice;
-    std::mt19937 pprGenerator(pprInternal::pprDevice());
-    std::uniform_real_distribution<double> pprDis(0.0, 1.0);
+    size_t roundWalks = 100;//walks per round, in the same unit of "iterations"
+    size_t stableRounds = 3;//rounds in a row with the same top-K needed to stop
+    double confidence = 3.0;//z of the bound c(K) - c(K+1) > z * sqrt(c(K) + c(K+1)), 0 to disable it
+    size_t walkBudget = 0;//walks for the whole run, 0 for no limit; once spent nodes only do their first round
+  };
 
-    template<typename Key>
-    vector<Key> executionOrder(const unordered_map<Key, vector<Key>>& graph)
+  /**
+   * Precomputed walk segments for mccompletepathv2 (see pprInternal::walkSegments):
+   * the nodes with the highest in-degree store a few short random walks, which
+   * walks passing through them splice in instead of stepping edge by edge.
+   * With a path the segments are loaded from the file if it holds the segments
+   * of the same graph with the same parameters, otherwise they are built and
+   * saved to it, so that runs on the same graph only build them once (loaded
+   * segments are the ones built with the seed of the run which saved them).
+   */
+  struct mcSegments
+  {
+    size_t length = 8;//edges of each segment
+    size_t perNode = 4;//segments of each node with segments
+    size_t memoryCap = 0;//max bytes of the segments and their offsets, 0 for no limit
+    std::string path;//file of the segments, empty for none
+  };
+
+  /**
+   * Statistics of a run of mccompletepathv2.
+   */
+  struct mcStats
+  {
+    size_t walks = 0;//random walks spent, in the same unit of "iterations"
+    size_t walkedNodes = 0;//nodes for which random walks have been done
+    size_t stoppedEarly = 0;//walked nodes which stopped before doing "iterations" walks
+    size_t components = 0;//strongly connected components of the graph
+    size_t splicedSegments = 0;//walk segments spliced in by the walks
+  };
+
+  namespace pprInternal
+  {
+    /**
+     * Execution order over the condensation of the graph: strongly connected
+     * components are done in reverse topological order, so the successors of a
+     * node out of its component always have a final map when the node is
+     * combined. Inside a component a node is ready once each of its successors
+     * in the component is done or has walked; when no node is ready the node
+     * to walk is picked greedily, the one with the most successors left to
+     * wait for times predecessors left waiting for it (nodes which are not on
+     * a cycle anymore are never picked), so that few nodes walk.
+     * Nodes picked to walk come after some of their predecessors in the order,
+     * which is what makes mccompletepathv2 walk them.
+     * @param successors   Successors of each node.
+     * @param predecessors Predecessors of each node (transpose of the successors).
+     * @param walked       If not nullptr set to the number of nodes picked to walk.
+     * @param components   If not nullptr set to the number of strongly connected components.
+     * @return Dense ids in execution order.
+     */
+    inline vector<size_t> sccExecutionOrder(const adjacency& successors, const adjacency& predecessors,
+      size_t* walked, size_t* components)
     {
-      //get list of predecessors for each node
-      unordered_map<Key, vector<Key>> predecessors; predecessors.reserve(graph.size());
-      for(const auto& keyVal: graph)
-      {
-        const Key& node = keyVal.first;
-        //init predecessors[v] to an empty vector, in case the node has no predecessors
-        predecessors[node];
-        const vector<Key>& successors = keyVal.second;
+      size_t n = successors.offsets.size() - 1;
+      vector<size_t> component;
+      size_t count = stronglyConnectedComponents(successors, component);
 
-        for(const Key& v: successors)
-          predecessors[v].push_back(node);
+      //nodes of each component, bucketed by component
+      adjacency members;
+      members.offsets.assign(count + 1, 0);
+      members.targets.resize(n);
+      for(size_t u = 0; u < n; u++)
+        members.offsets[component[u] + 1]++;
+      for(size_t c = 0; c < count; c++)
+        members.offsets[c + 1] += members.offsets[c];
+      {
+        vector<size_t> next(members.offsets.begin(), members.offsets.end() - 1);
+        for(size_t u = 0; u < n; u++)
+          members.targets[next[component[u]]++] = u;
       }
 
-      //tuple<node, indegree, outdegree>
-      vector<tuple<Key, size_t, size_t>> data; data.reserve(graph.size());
-      for(const auto& keyVal: graph)
-        data.push_back(std::make_tuple(keyVal.first, predecessors[keyVal.first].size(), keyVal.second.size()));
+      //successors in the same component not done nor walked yet, and
+      //predecessors in the same component not done yet (edges are counted
+      //with their repetitions, both ways)
+      vector<size_t> waitFor(n, 0);
+      vector<size_t> waiting(n, 0);
+      for(size_t u = 0; u < n; u++)
+        for(const size_t* it = successors.begin(u); it != successors.end(u); it++)
+          if(component[*it] == component[u])
+          {
+            waitFor[u]++;
+            waiting[*it]++;
+          }
 
-      std::sort(data.begin(), data.end(),
-        [](const tuple<Key, size_t, size_t>& t1, const tuple<Key, size_t, size_t>& t2)
+      vector<bool> done(n, false);
+      vector<bool> available(n, false);//done or walked
+      vector<size_t> order; order.reserve(n);
+      size_t picked = 0;
+      queue<size_t> ready;
+      //candidates to walk with their score, stale entries are skipped
+      std::priority_queue<pair<size_t, size_t>> candidates;
+      auto score = [&](size_t u) { return waitFor[u] * waiting[u]; };
+
+      //u is done or has walked, its predecessors in the component may be ready
+      auto release = [&](size_t u, size_t c)
+      {
+        available[u] = true;
+        for(const size_t* it = predecessors.begin(u); it != predecessors.end(u); it++)
         {
-          return (get<1>(t1) > get<1>(t2))? true :
-            (get<1>(t1) == get<1>(t2)? get<2>(t1) < get<2>(t2) : false);
-        });
+          size_t p = *it;
+          if(component[p] != c || done[p])
+            continue;
+          if(--waitFor[p] == 0)
+            ready.push(p);
+          else if(!available[p])
+            candidates.push(make_pair(score(p), p));
+        }
+      };
+
+      for(size_t c = 0; c < count; c++)
+      {
+        size_t left = members.degree(c);
+        for(const size_t* it = members.begin(c); it != members.end(c); it++)
+          if(waitFor[*it] == 0)
+            ready.push(*it);
+          else
+            candidates.push(make_pair(score(*it), *it));
 
-      vector<Key> sorted; sorted.reserve(data.size());
-      for(const auto& t: data)
-        sorted.push_back(get<0>(t));
+        while(true)
+        {
+          while(!ready.empty())
+          {
+            size_t u = ready.front();
+            ready.pop();
+            order.push_back(u);
+            done[u] = true;
+            left--;
+            for(const size_t* it = successors.begin(u); it != successors.end(u); it++)
+            {
+              size_t s = *it;
+              if(component[s] == c && !done[s] && --waiting[s] > 0 && !available[s])
+                candidates.push(make_pair(score(s), s));
+            }
+            if(!available[u])
+              release(u, c);
+          }
+          if(left == 0)
+            break;
+
+          //nothing is ready, there is a cycle among the nodes left
+          size_t w;
+          do
+          {
+            w = candidates.top().second;
+            size_t wScore = candidates.top().first;
+            candidates.pop();
+            if(!available[w] && wScore == score(w))
+              break;
+          }
+          while(true);
+          picked++;
+          release(w, c);
+        }
+      }
 
-      //after sorting the nodes use a heuristic to get a more
-      //efficient order
-      vector<Key> order; order.reserve(data.size());
-      queue<Key> qu;
+      if(walked != nullptr)
+        *walked = picked;
+      if(components != nullptr)
+        *components = count;
+      return order;
+    }
 
-      //remaining successors to wait for
-      unordered_map<Key, size_t> waitFor; waitFor.reserve(data.size());
-      for(const auto& keyVal: graph)
-        waitFor[keyVal.first] = keyVal.second.size();
+    //max number of walks advanced together by walkFrom
+    const size_t walkLanes = 16;
 
-      //keep track of visited nodes
-      unordered_set<Key> visited; visited.reserve(data.size());
+    /**
+     * Add the visits of random walks from a node to a counter of visits.
+     * A walk stops once a teleport happens (the length of the walk is drawn
+     * beforehand) or if it gets into a node without out going edges.
+     * Walks are advanced in lock-step, a few at a time: each lane takes one
+     * step and then the next lane goes, so while a lane waits for its turn the
+     * adjacency, index and counter slot of the node it just moved to (which
+     * have been prefetched) are loaded from memory, instead of each step
+     * waiting on the cache misses of the previous one.
+     * @param graph      Dense copy of the graph.
+     * @param index      Round robin index of each node, the next successor to pick.
+     * @param node       Node from which the walks start.
+     * @param walks      Number of walks to do.
+     * @param lengths    Sampler of the length of the walks.
+     * @param counter    Visit counts of the nodes other than "node", keeping the
+     * most visited ones.
+     * @param selfVisits Visits to "node" after the start of each walk, counted
+     * apart so that the node is never evicted from the counter.
+     * @param touched    See walkNode.
+     * @param segments   If not nullptr a walk getting to a node with at least
+     * segments->length() edges left splices in one of its segments, if any is left.
+     * @param lanes      Walks advanced together, in [1, walkLanes].
+     */
+    template<typename Key>
+    inline void walkFrom(const denseGraph<Key>& graph, vector<size_t>& index, size_t node,
+      size_t walks, walkLength& lengths, spaceSaving& counter, size_t& selfVisits,
+      vector<size_t>* touched, segmentReader* segments, size_t lanes = walkLanes)
+    {
+      const pprInternal::adjacency& successors = graph.successors;
+      size_t current[walkLanes];//node of each lane
+      size_t left[walkLanes];//edges left to traverse
+      bool pending[walkLanes];//the visit of the current node is still to be counted
+      size_t active = 0;
+      size_t started = 0;
+      lanes = std::max<size_t>(1, std::min(lanes, walkLanes));
+      for(; active < lanes && started < walks; active++, started++)
+      {
+        current[active] = node;
+        left[active] = lengths();
+        pending[active] = false;
+      }
 
-      for(const Key& node: sorted)
+      while(active > 0)
       {
-        if(visited.find(node) == visited.end())
+        for(size_t l = 0; l < active;)
         {
-          qu.push(node);
-          while(!qu.empty())
+          size_t currentNode = current[l];
+          if(pending[l])
+          {
+            if(currentNode == node)
+              selfVisits++;
+            else
+              counter.increment(currentNode);
+            pending[l] = false;
+          }
+
+          //splice a precomputed segment, the walk is surely going to traverse those edges
+          const size_t* segment = (segments != nullptr && left[l] >= segments->length())?
+            segments->take(currentNode) : nullptr;
+          if(segment != nullptr)
           {
-            const Key& next = qu.front();
-            order.push_back(next);
-            visited.insert(next);
-            const vector<Key>& nodePredecessors = predecessors[next];
-            qu.pop();
-
-            /*
-            for each predecessor decrement the remaining successors to wait
-            for and eventually consider it done when the remaining successors
-            get to 0
-            */
-            for(const Key& pred: nodePredecessors)
+            size_t steps = 0;
+            while(steps < segments->length() && segment[steps] != pprInternal::segmentEnd)
+              steps++;
+            for(size_t step = 0; step + 1 < steps; step++)
+              if(segment[step] == node)
+                selfVisits++;
+              else
+                counter.increment(segment[step]);
+            currentNode = segment[steps - 1];
+            PPR_PREFETCH(&successors.offsets[currentNode]);
+            counter.prefetch(currentNode);
+
+            current[l] = currentNode;
+            //a segment shorter than its length stopped at a node without successors
+            left[l] = (steps == segments->length())? left[l] - steps : 0;
+            pending[l] = true;
+            l++;
+            continue;
+          }
+
+          size_t degree = successors.degree(currentNode);
+          if(left[l] == 0 || degree == 0)
+          {
+            //the walk is over, the lane starts a new one or is dropped
+            if(started < walks)
+            {
+              current[l] = node;
+              left[l] = lengths();
+              started++;
+            }
+            else
             {
-              if(waitFor[pred]-- > 0)
-              {
-                //if the node doesn't have to wait for any successor
-                //it could be computed
-                if(!waitFor[pred] && visited.find(pred) == visited.end())
-                  qu.push(pred);
-              }
+              active--;
+              current[l] = current[active];
+              left[l] = left[active];
+              pending[l] = pending[active];
             }
+            continue;
           }
+
+          //increment index of the current node (wrapping around) and pick the next node
+          size_t& next = index[currentNode];
+          if(touched != nullptr && next == 0)
+            touched->push_back(currentNode);
+          if(++next == degree)
+            next = 0;
+          currentNode = successors.begin(currentNode)[next];
+          PPR_PREFETCH(&successors.offsets[currentNode]);
+          PPR_PREFETCH(&index[currentNode]);
+          counter.prefetch(currentNode);
+
+          current[l] = currentNode;
+          left[l]--;
+          pending[l] = true;
+          l++;
         }
       }
-      return order;
     }
 
+    //walk counters keep more ids than the ones returned, since Space-Saving
+    //only guarantees to keep the ids which take more than 1 / capacity of the visits
+    const size_t counterSlack = 4;
+
+    /**
+     * Top-n entries of a list of counts, by decreasing count (ties broken by id
+     * so that the order is well defined).
+     */
+    inline vector<pair<size_t, double>> topCounts(vector<pair<size_t, double>> data, size_t n)
+    {
+      n = std::min(n, data.size());
+      std::partial_sort(data.begin(), data.begin() + n, data.end(),
+        [](const pair<size_t, double>& p1, const pair<size_t, double>& p2)
+        { return p1.second > p2.second || (p1.second == p2.second && p1.first < p2.first);});
+      data.resize(n);
+      return data;
+    }
+
+    /**
+     * Visit counts of random walks, the top-n of a counter plus the visits of
+     * the node the walks started from.
+     */
+    inline unordered_map<size_t, double> counterMap(const spaceSaving& counter, size_t node,
+      double nodeVisits, size_t n)
+    {
+      vector<pair<size_t, double>> top = topCounts(counter.guaranteedEntries(), n);
+      unordered_map<size_t, double> res; res.reserve(top.size() + 1);
+      res[node] = nodeVisits;
+      for(const auto& entry: top)
+        if(entry.second > 0)
+          res.insert(entry);
+      return res;
+    }
+
+    /**
+     * Random walks from a node, with the round robin index of each node and the
+     * random generator provided by the caller, so that different threads can
+     * walk at the same time (each with its own index and generator).
+     * Visits are counted by a spaceSaving (see counterSlack) and the top K - 1
+     * nodes are kept (the node itself is always part of the map), so the most
+     * visited nodes are kept even if they are reached late; the counts are the
+     * guaranteed ones, which never overestimate the visits.
+     * @param graph     Dense copy of the graph.
+     * @param index     Round robin index of each node, the next successor to pick.
+     * @param slots     Scratch for the counter, of the size of the graph and all
+     * set to noSlot, left as it was found.
+     * @param node      Node from which the walks start.
+     * @param K         Max size of the resulting map.
+     * @param damping
+     * @param walks     Number of walks in the worst case.
+     * @param generator
+     * @param touched If not nullptr the nodes whose index has been moved away
+     * from 0 are appended to it (possibly more than once), so that the caller
+     * can reset them.
+     * @param segments  If not nullptr walks splice in its segments (see walkFrom),
+     * it is reset before returning.
+     * @return Map from dense ids to the mean number of visits.
+     */
     template<typename Key>
-    inline unordered_map<Key, double> walkNode(const unordered_map<Key, vector<Key>>& graph,
-      unordered_map<Key, size_t>& index, Key node, const size_t K, double damping, size_t walks)
+    inline unordered_map<size_t, double> walkNode(const denseGraph<Key>& graph,
+      vector<size_t>& index, vector<size_t>& slots, size_t node, const size_t K, double damping,
+      size_t walks, xoshiro256& generator, vector<size_t>* touched, segmentReader* segments)
     {
-      unordered_map<Key, double> res;
-      if(graph.find(node)->second.size() > 0)
+      unordered_map<size_t, double> res;
+      if(graph.successors.degree(node) > 0)
       {
-        res.reserve(K);
-        //each walk will surely start from the origin node
-        res[node] = walks;
-        size_t bk = walks;
+        size_t entries = (K > 0)? K - 1 : 0;
+        spaceSaving counter(entries * counterSlack, slots);
+        size_t selfVisits = 0;
 
         /*
         a part of the walks is wasted because a teleport happens before traversing
         the first edge, so we account for those walks here (lowering the total walks)
         but make it so that the first edge is always traversed
         */
-        walks = static_cast<size_t> (static_cast<double>(walks) * damping);
-
-        for(size_t i = 0; i < walks; i++)
-        {
-          const Key* currentNode = &node;
-
-          /*
-          random walk which stops if a teleport happens (teleported > damping)
-          or if it gets into a node without out going edges
-          */
-          do
-          {
-            if(graph.find(*currentNode)->second.size() == 0)
-              break;
-            else
-            {
-              //increment index of the current node and pick the next node
-              currentNode = &graph.find(*currentNode)->second[(index[*currentNode] = (++index[*currentNode]) % graph.find(*currentNode)->second.size())];
+        pprInternal::walkLength lengths(generator, damping);
+        walkFrom(graph, index, node, static_cast<size_t> (static_cast<double>(walks) * damping),
+          lengths, counter, selfVisits, touched, segments);
+        if(segments != nullptr)
+          segments->reset();
 
-              //increment node score only if it won't make the map size greater than what's allowed
-              if(res.find(*currentNode) != res.end() || res.size() < K)
-                res[*currentNode]++;
-            }
-          }while(pprInternal::pprDis(pprInternal::pprGenerator) <= damping);
+        //each walk surely starts from the origin node
+        res = counterMap(counter, node, walks + selfVisits, entries);
 
-        }
         //divide by the number of walks done to obtain the mean
         for(auto& keyVal: res)
-          keyVal.second /= bk;
+          keyVal.second /= walks;
       }
       else
         res[node] = 1.0;
       return res;
     }
+
+    /**
+     * Same as walkNode but walking in rounds, stopping once the top-K of the
+     * node is stable (see mcAdaptive).
+     * @param slots     See walkNode.
+     * @param K         Top-K which has to be stable.
+     * @param L         Max size of the resulting map.
+     * @param walks     Number of walks in the worst case.
+     * @param budget    Walks left for the whole run, decreased by the walks done.
+     * @param adaptive
+     * @param spent     Set to the number of walks done.
+     * @param segments  See walkNode.
+     * @return Map from dense ids to the mean number of visits.
+     */
+    template<typename Key>
+    inline unordered_map<size_t, double> walkNodeAdaptive(const denseGraph<Key>& graph,
+      vector<size_t>& index, vector<size_t>& slots, size_t node, const size_t K, const size_t L,
+      double damping, size_t walks, size_t& budget, const mcAdaptive& adaptive,
+      xoshiro256& generator, size_t& spent, segmentReader* segments)
+    {
+      unordered_map<size_t, double> res;
+      spent = 0;
+      if(graph.successors.degree(node) == 0)
+      {
+        res[node] = 1.0;
+        return res;
+      }
+
+      size_t entries = (L > 0)? L - 1 : 0;
+      spaceSaving counter(entries * counterSlack, slots);
+      size_t selfVisits = 0;
+      pprInternal::walkLength lengths(generator, damping);
+      size_t round = std::max<size_t>(adaptive.roundWalks, 1);
+      vector<pair<size_t, double>> previousTop;
+      size_t stable = 0;
+
+      while(spent < walks)
+      {
+        size_t target = std::min(walks, spent + round);
+        //walks actually done, see walkNode for the damping factor
+        size_t done = static_cast<size_t> (static_cast<double>(spent) * damping);
+        walkFrom(graph, index, node, static_cast<size_t> (static_cast<double>(target) * damping) - done,
+          lengths, counter, selfVisits, nullptr, segments);
+        budget -= std::min(budget, target - spent);
+        spent = target;
+        if(budget == 0)
+          break;
+
+        //same nodes in the same order for a number of rounds in a row
+        vector<pair<size_t, double>> counts = counter.guaranteedEntries();
+        counts.push_back(make_pair(node, static_cast<double>(spent + selfVisits)));
+        vector<pair<size_t, double>> top = topCounts(move(counts), K + 1);
+        size_t k = std::min(K, top.size());
+        bool sameTop = !previousTop.empty() && previousTop.size() >= k &&
+          std::equal(top.begin(), top.begin() + k, previousTop.begin(),
+            [](const pair<size_t, double>& p1, const pair<size_t, double>& p2)
+            { return p1.first == p2.first;});
+        stable = sameTop? stable + 1 : 0;
+        if(stable >= adaptive.stableRounds)
+          break;
+
+        //count of the K-th node far enough from the (K+1)-th one
+        if(adaptive.confidence > 0 && top.size() >= K)
+        {
+          double kth = top[K - 1].second;
+          double after = (top.size() > K)? top[K].second : 0;
+          if(kth - after > adaptive.confidence * std::sqrt(kth + after))
+            break;
+        }
+        previousTop.swap(top);
+      }
+
+      if(segments != nullptr)
+        segments->reset();
+      res = counterMap(counter, node, spent + selfVisits, entries);
+      for(auto& keyVal: res)
+        keyVal.second /= spent;
+      return res;
+    }
+
+    /**
+     * Give a map to the nodes left without a final one by a run stopped by its
+     * budget: the map of their random walks if they have one, otherwise the
+     * first step of the walks (the node itself and its successors).
+     * @param graph    Dense copy of the graph.
+     * @param maps     Map of each node, the ones of the unfinished nodes are replaced.
+     * @param finished True for the nodes with a final map.
+     * @param walkMaps Random walk map of each node (empty if it has not walked),
+     * can be the same as maps.
+     * @param damping
+     */
+    template<typename Key, typename Flags>
+    void fillUnfinished(const denseGraph<Key>& graph, vector<unordered_map<size_t, double>>& maps,
+      const Flags& finished, vector<unordered_map<size_t, double>>& walkMaps, double damping)
+    {
+      const adjacency& successors = graph.successors;
+      for(size_t u = 0; u < graph.size(); u++)
+      {
+        if(finished[u])
+          continue;
+        if(!walkMaps[u].empty())
+        {
+          if(&maps[u] != &walkMaps[u])
+            maps[u] = move(walkMaps[u]);
+          continue;
+        }
+        unordered_map<size_t, double> map;
+        map[u] = 1.0;
+        size_t degree = successors.degree(u);
+        for(const size_t* it = successors.begin(u); it != successors.end(u); it++)
+          map[*it] += damping / degree;
+        maps[u] = move(map);
+      }
+    }
+
+    /**
+     * Keep the top-K of each map (indexed by dense id) and translate ids back
+     * to the nodes of the graph.
+     * @param graph Dense copy of the graph.
+     * @param maps  Map of each node, emptied by the call.
+     * @param K
+     */
+    template<typename Key>
+    unordered_map<Key, unordered_map<Key, double>> toKeyMaps(const denseGraph<Key>& graph,
+      vector<unordered_map<size_t, double>>& maps, size_t K)
+    {
+      unordered_map<Key, unordered_map<Key, double>> scores; scores.reserve(graph.size());
+      for(size_t u = 0; u < graph.size(); u++)
+      {
+        keepTop(K, maps[u]);
+        unordered_map<Key, double>& map = scores[graph.keys[u]];
+        map.reserve(K);
+        for(const auto& keyVal: maps[u])
+          map.insert(make_pair(graph.keys[keyVal.first], keyVal.second));
+        unordered_map<size_t, double>().swap(maps[u]);
+      }
+      return scores;
+    }
   }
 
 
@@ -172,11 +579,21 @@ namespace ppr
    * nodes for which an edge exists between the key node and the nodes in the vector.
    * Nodes which have no edges must still be part of the map, and are mapped to an
    * empty vector.
+   * Nodes are combined following sccExecutionOrder, random walks are done only
+   * for the nodes it picks to break the cycles of the graph.
    * @param graph      Graph for which to calculate ppr for all sources.
    * @param K          Number of entries (nodes) for each source, the ppr top-K scoring nodes for the source node.
    * @param L          Number of entries (nodes) for each source to store during computation.
    * @param iterations Number of random walks to do for each node in the worst case.
    * @param damping    Damping factor, a la Pagerank.
+   * @param seed       Seed of the random walks, runs with the same seed give the same results.
+   * @param adaptive   If not nullptr nodes walk in rounds until their top-K is stable (see mcAdaptive),
+   * "iterations" is then the max number of walks of a node.
+   * @param stats      If not nullptr it is filled with the walks spent.
+   * @param segments   If not nullptr walks splice in precomputed walk segments (see mcSegments).
+   * @param budget     If not nullptr the run stops once it expires (checked before
+   * each node), nodes without a final map then get the map of their random walks
+   * or, if they have not walked, the first step of the walks.
    * @return Maps of each node, storing theirs personalized pagerank top-K basket.
    */
   template<typename Key>
@@ -184,7 +601,12 @@ namespace ppr
   size_t K,//small top
   size_t L,//large top
   size_t iterations,//number of monte carlo random walks for each node in the worst case
-  double damping)//damping factor
+  double damping,//damping factor
+  uint64_t seed,//seed of the random walks
+  const mcAdaptive* adaptive,//adaptive walk budget, can be nullptr
+  mcStats* stats,//statistics of the run, can be nullptr
+  const mcSegments* segments,//walk segments, can be nullptr
+  runBudget* budget)//cancellation and deadline, can be nullptr
   {
     //checking parameters
     if(K == 0){cerr << "K must be positive" << endl; exit(EXIT_FAILURE);}
@@ -192,50 +614,105 @@ namespace ppr
     if(K > L){cerr << "K must be <= L" << endl; exit(EXIT_FAILURE);}
     if(iterations == 0){cerr << "iterations must be positive" << endl; exit(EXIT_FAILURE);}
     if(damping < 0 || damping > 1){cerr << "damping must be [0,1]" << endl; exit(EXIT_FAILURE);}
+    if(segments != nullptr && segments->length == 0){cerr << "segments length must be positive" << endl; exit(EXIT_FAILURE);}
+
+    memoryPhase phase("mccompletepathv2");
+    memoryScope scope(memoryGraph);
+    const denseGraph<Key> dense = pprInternal::makeDenseGraph(graph);
+    const pprInternal::adjacency& successors = dense.successors;
+    const pprInternal::adjacency predecessors = pprInternal::transpose(successors);
 
     //allocate  maps
     //there is no map storing the results from the random walks because "scores"
     //is used to store them while the node still doesn't have a final result
-    unordered_map<Key, unordered_map<Key, double>> scores; scores.reserve(graph.size());
+    scope.set(memoryScores);
+    vector<unordered_map<size_t, double>> scores(dense.size());
+    scope.set(memoryScratch);
+    //true if a node has a map in scores, either final or from its random walks
+    vector<bool> computed(dense.size(), false);
 
     //each node has an index that tells which successor is going to be picked
     //next while moving away from the node during a random walk
-    unordered_map<Key, size_t> index; index.reserve(graph.size());
+    vector<size_t> index(dense.size(), 0);
+    //scratch of the visit counters of the walks
+    vector<size_t> slots(dense.size(), pprInternal::noSlot);
+
+    //segments have their own generator, so that the walks don't depend on
+    //the segments being built or loaded
+    pprInternal::walkSegments store;
+    vector<size_t> used;
+    std::unique_ptr<segmentReader> reader;
+    if(segments != nullptr)
+    {
+      uint64_t graphFingerprint = pprInternal::fingerprint(dense);
+      if(segments->path.empty() || !store.load(segments->path, graphFingerprint, dense.size(),
+        segments->length, segments->perNode, segments->memoryCap))
+      {
+        store = pprInternal::buildSegments(dense, segments->length, segments->perNode, segments->memoryCap,
+          pprInternal::deriveSeed(seed, dense.size()));
+        if(!segments->path.empty() && !store.save(segments->path))
+          cerr << "could not save the walk segments to " << segments->path << endl;
+      }
+      used.assign(dense.size(), 0);
+      reader.reset(new segmentReader(store, used));
+    }
 
-    //init the index of every node at 0
-    for(const auto& keyVal: graph)
-      index[keyVal.first];
+    xoshiro256 generator(seed);
+    mcStats runStats;
+    size_t walkBudget = (adaptive != nullptr && adaptive->walkBudget > 0)? adaptive->walkBudget : SIZE_MAX;
 
-    vector<Key> order = pprInternal::executionOrder(graph);
+    vector<size_t> order = pprInternal::sccExecutionOrder(successors, predecessors, nullptr,
+      &runStats.components);
 
-    for(const Key& node: order)
+    //the maps of the walks and of the combinations, the counters of the walks
+    //are accounted with them
+    scope.set(memoryScores);
+    //nodes with a final map, the first "finished" of the order
+    size_t finished = 0;
+    for(size_t node: order)
     {
-      unordered_map<Key, double> map; map.reserve(L * graph.find(node)->second.size());
-      double factor = (graph.find(node)->second.size() == 0) ? 1.0 : damping / graph.find(node)->second.size();
+      //nodes may walk, which costs way more than reading the clock, so the
+      //budget is checked before each of them
+      if(pprInternal::budgetExpired(budget, 0))
+        break;
+      size_t degree = successors.degree(node);
+      unordered_map<size_t, double> map; map.reserve(L * degree);
+      double factor = (degree == 0) ? 1.0 : damping / degree;
 
       /*
       every walk starts from the node, this can't be added later otherwise
       keepTop might remove a small score for "node" and then adding 1 to the node
       will cause the map to have a size of smallTop + 1.
       division by the factor is needed to take into consideration
-      the map multiplication of each value (see around line 248), which averages by outdegree and
+      the map multiplication of each value (see below), which averages by outdegree and
       scales down values using the damping factor; since
       the score for the node itself must not be scaled down the division
       is performed
       */
       map[node] = 1.0 / factor;
 
-      for(const Key& successor: graph.find(node)->second)
+      for(const size_t* it = successors.begin(node); it != successors.end(node); it++)
       {
+        size_t successor = *it;
         /*if nothing is mapped to the successor it means that there are no
         final results for that node AND that the node has not walked yet, so
         random walks are done for the node.
         When the node will be finally executed the map resulting from the walks
         will be simply "overwritten" by the final result.*/
-        if(scores.find(successor) == scores.end())
+        if(!computed[successor])
         {
-          scores.insert(make_pair(successor, move(ppr::pprInternal::walkNode(graph,
-            index, successor, L, damping, iterations))));
+          size_t spent = (successors.degree(successor) > 0)? iterations : 0;
+          if(adaptive == nullptr)
+            scores[successor] = ppr::pprInternal::walkNode(dense, index, slots, successor, L,
+              damping, iterations, generator, nullptr, reader.get());
+          else
+            scores[successor] = ppr::pprInternal::walkNodeAdaptive(dense, index, slots, successor, K,
+              L, damping, iterations, walkBudget, *adaptive, generator, spent, reader.get());
+          computed[successor] = true;
+
+          runStats.walks += spent;
+          runStats.walkedNodes += spent > 0;
+          runStats.stoppedEarly += spent > 0 && spent < iterations;
         }
         for(const auto& keyVal: scores[successor])
           map[keyVal.first] += keyVal.second;
@@ -247,14 +724,355 @@ namespace ppr
         keyVal.second *= factor;
 
       scores[node] = move(map);
+      computed[node] = true;
+      finished++;
     }
 
-    for(auto& keyVal: scores)
+    if(finished < order.size())
     {
-      keepTop(K, keyVal.second);
-      keyVal.second.rehash(K);
+      //scores of the unfinished nodes that walked are their walk maps
+      vector<bool> final(dense.size(), false);
+      for(size_t i = 0; i < finished; i++)
+        final[order[i]] = true;
+      pprInternal::fillUnfinished(dense, scores, final, scores, damping);
     }
-    return scores;
+
+    if(reader)
+      runStats.splicedSegments = reader->splicedSegments();
+    if(stats != nullptr)
+      *stats = runStats;
+    return pprInternal::toKeyMaps(dense, scores, K);
+  }
+
+  /**
+   * Same as mccompletepathv2 without a budget.
+   */
+  template<typename Key>
+  unordered_map<Key, unordered_map<Key, double>> mccompletepathv2(const unordered_map<Key, vector<Key>>& graph, //the graph
+  size_t K,//small top
+  size_t L,//large top
+  size_t iterations,//number of monte carlo random walks for each node in the worst case
+  double damping,//damping factor
+  uint64_t seed,//seed of the random walks
+  const mcAdaptive* adaptive,//adaptive walk budget, can be nullptr
+  mcStats* stats,//statistics of the run, can be nullptr
+  const mcSegments* segments)//walk segments, can be nullptr
+  {
+    return mccompletepathv2(graph, K, L, iterations, damping, seed, adaptive, stats, segments, nullptr);
+  }
+
+  /**
+   * Same as mccompletepathv2 without walk segments.
+   */
+  template<typename Key>
+  unordered_map<Key, unordered_map<Key, double>> mccompletepathv2(const unordered_map<Key, vector<Key>>& graph, //the graph
+  size_t K,//small top
+  size_t L,//large top
+  size_t iterations,//number of monte carlo random walks for each node in the worst case
+  double damping,//damping factor
+  uint64_t seed,//seed of the random walks
+  const mcAdaptive* adaptive,//adaptive walk budget, can be nullptr
+  mcStats* stats)//statistics of the run, can be nullptr
+  {
+    return mccompletepathv2(graph, K, L, iterations, damping, seed, adaptive, stats, nullptr);
+  }
+
+  /**
+   * Same as mccompletepathv2 with a fixed number of walks for each node.
+   * @param graph      Graph for which to calculate ppr for all sources.
+   * @param K          Number of entries (nodes) for each source, the ppr top-K scoring nodes for the source node.
+   * @param L          Number of entries (nodes) for each source to store during computation.
+   * @param iterations Number of random walks to do for each node in the worst case.
+   * @param damping    Damping factor, a la Pagerank.
+   * @param seed       Seed of the random walks, runs with the same seed give the same results.
+   * @return Maps of each node, storing theirs personalized pagerank top-K basket.
+   */
+  template<typename Key>
+  unordered_map<Key, unordered_map<Key, double>> mccompletepathv2(const unordered_map<Key, vector<Key>>& graph, //the graph
+  size_t K,//small top
+  size_t L,//large top
+  size_t iterations,//number of monte carlo random walks for each node in the worst case
+  double damping,//damping factor
+  uint64_t seed)//seed of the random walks
+  {
+    return mccompletepathv2(graph, K, L, iterations, damping, seed, nullptr, nullptr, nullptr);
+  }
+
+  /**
+   * Same as the seeded mccompletepathv2, with a non deterministic seed.
+   * @param graph      Graph for which to calculate ppr for all sources.
+   * @param K          Number of entries (nodes) for each source, the ppr top-K scoring nodes for the source node.
+   * @param L          Number of entries (nodes) for each source to store during computation.
+   * @param iterations Number of random walks to do for each node in the worst case.
+   * @param damping    Damping factor, a la Pagerank.
+   * @return Maps of each node, storing theirs personalized pagerank top-K basket.
+   */
+  template<typename Key>
+  unordered_map<Key, unordered_map<Key, double>> mccompletepathv2(const unordered_map<Key, vector<Key>>& graph, //the graph
+  size_t K,//small top
+  size_t L,//large top
+  size_t iterations,//number of monte carlo random walks for each node in the worst case
+  double damping)//damping factor
+  {
+    return mccompletepathv2(graph, K, L, iterations, damping, pprInternal::randomSeed());
+  }
+
+  /**
+   * Multi threaded version of mccompletepathv2, see mccompletepathv2 for the
+   * parameters. Nodes are still combined following the execution order, but a
+   * node is scheduled as soon as the maps it needs are ready: the final maps of
+   * the successors that come before it in the order, and the random walk maps
+   * of the others (which the sequential version would walk when needed).
+   * Random walks are independent of each other, so all of them are scheduled
+   * from the start and run concurrently on the worker threads.
+   * The walks of each node have their own generator (derived from the seed and
+   * the node) and start from reset round robin indexes, so results only depend
+   * on the seed and not on the number of threads or on the scheduling.
+   * @param nThreads Number of threads to use (one at least).
+   * @param seed     Seed of the random walks.
+   * @param stats    If not nullptr it is filled with the walks spent.
+   * @param budget   If not nullptr the run stops once it expires (checked before
+   * each task), see mccompletepathv2 for the maps of the
+   * unfinished nodes.
+   */
+  template<typename Key>
+  unordered_map<Key, unordered_map<Key, double>> mccompletepathv2Multi(const unordered_map<Key, vector<Key>>& graph, //the graph
+  size_t K,//small top
+  size_t L,//large top
+  size_t iterations,//number of monte carlo random walks for each node in the worst case
+  double damping,//damping factor
+  size_t nThreads,//number of threads, at least 1
+  uint64_t seed,//seed of the random walks
+  mcStats* stats,//statistics of the run, can be nullptr
+  runBudget* budget)//cancellation and deadline, can be nullptr
+  {
+    //checking parameters
+    if(K == 0){cerr << "K must be positive" << endl; exit(EXIT_FAILURE);}
+    if(L == 0){cerr << "L must be positive" << endl; exit(EXIT_FAILURE);}
+    if(K > L){cerr << "K must be <= L" << endl; exit(EXIT_FAILURE);}
+    if(iterations == 0){cerr << "iterations must be positive" << endl; exit(EXIT_FAILURE);}
+    if(damping < 0 || damping > 1){cerr << "damping must be [0,1]" << endl; exit(EXIT_FAILURE);}
+    if(nThreads == 0){cerr << "nThreads must be positive" << endl; exit(EXIT_FAILURE);}
+
+    memoryPhase phase("mccompletepathv2Multi");
+    memoryScope scope(memoryGraph);
+    const denseGraph<Key> dense = pprInternal::makeDenseGraph(graph);
+    const pprInternal::adjacency& successors = dense.successors;
+    const pprInternal::adjacency predecessors = pprInternal::transpose(successors);
+    const size_t n = dense.size();
+    scope.set(memoryScratch);
+
+    //position of each node in the execution order
+    vector<size_t> position(n);
+    mcStats runStats;
+    {
+      vector<size_t> order = pprInternal::sccExecutionOrder(successors, predecessors, nullptr,
+        &runStats.components);
+      for(size_t i = 0; i < n; i++)
+        position[order[i]] = i;
+    }
+
+    /*
+    a successor s of u is needed as a final map if it comes before u in the
+    order, otherwise (self loops included) its random walk map is needed;
+    waitFor counts the maps u is still waiting for, walkUsers the nodes still
+    needing the walk map of s, which is freed once nobody needs it anymore
+    */
+    vector<std::atomic<size_t>> waitFor(n);
+    vector<std::atomic<size_t>> walkUsers(n);
+    for(size_t s = 0; s < n; s++)
+      walkUsers[s] = 0;
+    for(size_t u = 0; u < n; u++)
+    {
+      waitFor[u] = successors.degree(u);
+      for(const size_t* it = successors.begin(u); it != successors.end(u); it++)
+        if(position[*it] >= position[u])
+          walkUsers[*it]++;
+    }
+
+    scope.set(memoryScores);
+    vector<unordered_map<size_t, double>> finalMaps(n);
+    vector<unordered_map<size_t, double>> walkMaps(n);
+    scope.set(memoryScratch);
+    //nodes with a final map, each one is written by the thread computing it
+    vector<char> finished(n, 0);
+
+    //a task is a node id, walks are encoded as id + n
+    vector<size_t> ready;
+    for(size_t s = 0; s < n; s++)
+      if(walkUsers[s] > 0)
+        ready.push_back(s + n);
+    for(size_t u = 0; u < n; u++)
+      if(waitFor[u] == 0)
+        ready.push_back(u);
+
+    std::mutex mutex;
+    std::condition_variable available;
+    size_t remaining = n;//final maps still to compute
+    //walks actually done, counted once they are over so that a budget stop
+    //doesn't report the walks of tasks that never ran
+    std::atomic<size_t> walks(0);
+    std::atomic<size_t> walkedNodes(0);
+
+    auto worker = [&]()
+    {
+      xoshiro256 generator;
+      memoryScope workerScope(memoryScratch);
+      //each thread has its own round robin index of each node, reset after each node walks
+      vector<size_t> index(n, 0);
+      vector<size_t> slots(n, pprInternal::noSlot);
+      vector<size_t> touched;
+      workerScope.set(memoryScores);
+
+      while(true)
+      {
+        size_t task;
+        {
+          std::unique_lock<std::mutex> lock(mutex);
+          available.wait(lock, [&](){ return !ready.empty() || remaining == 0; });
+          if(ready.empty() || remaining == 0)
+            return;
+          //out of budget (checked before each task, see mccompletepathv2), the
+          //other threads stop at their next task
+          if(pprInternal::budgetExpired(budget, 0))
+          {
+            remaining = 0;
+            ready.clear();
+            available.notify_all();
+            return;
+          }
+          task = ready.back();
+          ready.pop_back();
+        }
+
+        vector<size_t> released;
+        if(task >= n)
+        {
+          size_t s = task - n;
+          generator.reseed(pprInternal::deriveSeed(seed, s));
+          walkMaps[s] = pprInternal::walkNode(dense, index, slots, s, L, damping, iterations, generator,
+            &touched, nullptr);
+          for(size_t node: touched)
+            index[node] = 0;
+          touched.clear();
+          //see mccompletepathv2, nodes without successors don't really walk
+          if(successors.degree(s) > 0)
+          {
+            walks.fetch_add(iterations, std::memory_order_relaxed);
+            walkedNodes.fetch_add(1, std::memory_order_relaxed);
+          }
+
+          //predecessors waiting for the walk map of s
+          for(const size_t* it = predecessors.begin(s); it != predecessors.end(s); it++)
+            if(position[s] >= position[*it] && --waitFor[*it] == 0)
+              released.push_back(*it);
+        }
+        else
+        {
+          size_t u = task;
+          size_t degree = successors.degree(u);
+          double factor = (degree == 0) ? 1.0 : damping / degree;
+
+          //see mccompletepathv2
+          unordered_map<size_t, double> map; map.reserve(L * degree);
+          map[u] = 1.0 / factor;
+          for(const size_t* it = successors.begin(u); it != successors.end(u); it++)
+          {
+            size_t s = *it;
+            bool isFinal = position[s] < position[u];
+            for(const auto& keyVal: isFinal? finalMaps[s] : walkMaps[s])
+              map[keyVal.first] += keyVal.second;
+            if(!isFinal && --walkUsers[s] == 0)
+              unordered_map<size_t, double>().swap(walkMaps[s]);
+          }
+          keepTop(L, map);
+
+          for(auto& keyVal: map)
+            keyVal.second *= factor;
+          finalMaps[u] = move(map);
+          finished[u] = 1;
+
+          //predecessors waiting for the final map of u
+          for(const size_t* it = predecessors.begin(u); it != predecessors.end(u); it++)
+            if(position[u] < position[*it] && --waitFor[*it] == 0)
+              released.push_back(*it);
+        }
+
+        bool done;
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          ready.insert(ready.end(), released.begin(), released.end());
+          if(task < n && remaining > 0)
+            remaining--;
+          done = remaining == 0;
+        }
+        if(done || released.size() > 1)
+          available.notify_all();
+        else if(released.size() == 1)
+          available.notify_one();
+      }
+    };
+
+    vector<std::thread> threads;
+    for(size_t t = 0; t < nThreads; t++)
+      threads.emplace_back(worker);
+    for(auto& t: threads)
+      t.join();
+    runStats.walks = walks;
+    runStats.walkedNodes = walkedNodes;
+
+    scope.set(memoryScores);
+    if(budget != nullptr)
+      pprInternal::fillUnfinished(dense, finalMaps, finished, walkMaps, damping);
+
+    if(stats != nullptr)
+      *stats = runStats;
+    return pprInternal::toKeyMaps(dense, finalMaps, K);
+  }
+
+  /**
+   * Same as mccompletepathv2Multi without a budget.
+   */
+  template<typename Key>
+  unordered_map<Key, unordered_map<Key, double>> mccompletepathv2Multi(const unordered_map<Key, vector<Key>>& graph, //the graph
+  size_t K,//small top
+  size_t L,//large top
+  size_t iterations,//number of monte carlo random walks for each node in the worst case
+  double damping,//damping factor
+  size_t nThreads,//number of threads, at least 1
+  uint64_t seed,//seed of the random walks
+  mcStats* stats)//statistics of the run, can be nullptr
+  {
+    return mccompletepathv2Multi(graph, K, L, iterations, damping, nThreads, seed, stats, nullptr);
+  }
+
+  /**
+   * Same as mccompletepathv2Multi without statistics.
+   */
+  template<typename Key>
+  unordered_map<Key, unordered_map<Key, double>> mccompletepathv2Multi(const unordered_map<Key, vector<Key>>& graph, //the graph
+  size_t K,//small top
+  size_t L,//large top
+  size_t iterations,//number of monte carlo random walks for each node in the worst case
+  double damping,//damping factor
+  size_t nThreads,//number of threads, at least 1
+  uint64_t seed)//seed of the random walks
+  {
+    return mccompletepathv2Multi(graph, K, L, iterations, damping, nThreads, seed, nullptr);
+  }
+
+  /**
+   * Same as the seeded mccompletepathv2Multi, with a non deterministic seed.
+   */
+  template<typename Key>
+  unordered_map<Key, unordered_map<Key, double>> mccompletepathv2Multi(const unordered_map<Key, vector<Key>>& graph, //the graph
+  size_t K,//small top
+  size_t L,//large top
+  size_t iterations,//number of monte carlo random walks for each node in the worst case
+  double damping,//damping factor
+  size_t nThreads)//number of threads, at least 1
+  {
+    return mccompletepathv2Multi(graph, K, L, iterations, damping, nThreads, pprInternal::randomSeed());
   }
 }
 #endif
@@ -0,0 +1,336 @@
+#ifndef PPRPUSH_H
+#define PPRPUSH_H
+
+#include <algorithm>//max
+#include <iostream>
+#include <queue>
+#include <stdint.h>
+#include <stdlib.h>//exit
+#include <unordered_map>
+#include <vector>
+
+#include <internal/pprInternal.h>
+#include <internal/pprRandom.h>
+
+using std::cerr; using std::endl;
+using std::queue;
+using std::unordered_map;
+using std::vector;
+
+using ppr::pprInternal::keepTop;
+using ppr::pprInternal::predecessorsOf;
+using ppr::pprInternal::walkLength;
+using ppr::pprInternal::xoshiro256;
+
+namespace ppr
+{
+  namespace pprInternal
+  {
+    /**
+     * Backward push (Andersen, Borgs, Chayes, Hopcroft, Mirrokni, Teng, "Local
+     * computation of PageRank contributions") towards a target t: each node v
+     * has an estimate p[v] and a residual r[v] such that for every source s
+     * ppr(s, t) = p[s] + sum over v of ppr(s, v) * r[v].
+     * The target starts with all the residual, a node whose residual is more
+     * than epsilon keeps 1 - damping of it as estimate and gives each of its
+     * predecessors u damping * r / outdegree(u) (for each edge u -> v), so
+     * once no residual is more than epsilon every estimate is below
+     * ppr(s, t) by less than epsilon.
+     * @param graph        The graph.
+     * @param predecessors Transpose of the graph (see predecessorsOf).
+     * @param target
+     * @param damping      Damping factor, [0, 1).
+     * @param epsilon      Residual threshold.
+     * @param estimates    Filled with the estimates, must be empty.
+     * @param residuals    Filled with the residuals left, must be empty.
+     */
+    template<typename Key>
+    void pushBackward(const unordered_map<Key, vector<Key>>& graph,
+      const unordered_map<Key, vector<Key>>& predecessors, const Key& target, double damping, double epsilon,
+      unordered_map<Key, double>& estimates, unordered_map<Key, double>& residuals)
+    {
+      queue<Key> que;
+      residuals[target] = 1.0;
+      que.push(target);
+      while(!que.empty())
+      {
+        Key node = que.front();
+        que.pop();
+        double& residual = residuals[node];
+        double mass = residual;
+        residual = 0;
+
+        estimates[node] += (1.0 - damping) * mass;
+        auto it = predecessors.find(node);
+        if(it == predecessors.end())
+          continue;
+        for(const Key& predecessor: it->second)
+        {
+          double& next = residuals[predecessor];
+          double share = damping * mass / graph.find(predecessor)->second.size();
+          //queue it only when it goes over the threshold, if it already was
+          //it is in the queue
+          if(next <= epsilon && next + share > epsilon)
+            que.push(predecessor);
+          next += share;
+        }
+      }
+    }
+
+    /**
+     * Forward push from a source s (see forwardPush): each node v has an
+     * estimate p[v] and a residual r[v] such that for every node t
+     * ppr(s, t) = p[t] + sum over v of r[v] * ppr(v, t).
+     * The source starts with all the residual, a node whose residual is more
+     * than epsilon times its outdegree (one for nodes without successors)
+     * keeps 1 - damping of it as estimate and pushes the rest evenly to its
+     * successors, so once it ends the residual of every node is at most epsilon
+     * times its outdegree, and since the ppr of a node sums to at most one the
+     * estimates are below ppr(s, t) by at most the sum of the residuals left,
+     * each and all together.
+     * @param graph     The graph, every node must be a key of the map.
+     * @param source
+     * @param damping   Damping factor, [0, 1).
+     * @param epsilon   Residual threshold.
+     * @param estimates Filled with the estimates, must be empty.
+     * @param residuals Filled with the residuals left, must be empty.
+     */
+    template<typename Key>
+    void pushForward(const unordered_map<Key, vector<Key>>& graph, const Key& source, double damping,
+      double epsilon, unordered_map<Key, double>& estimates, unordered_map<Key, double>& residuals)
+    {
+      //nodes whose residual is over the threshold, each node is queued once
+      //every time it goes over it
+      queue<Key> que;
+
+      residuals[source] = 1.0;
+      que.push(source);
+      while(!que.empty())
+      {
+        Key node = que.front();
+        que.pop();
+        const vector<Key>& successors = graph.find(node)->second;
+        double& residual = residuals[node];
+        double mass = residual;
+        residual = 0;
+
+        estimates[node] += (1.0 - damping) * mass;
+        if(successors.empty())
+          continue;
+
+        double share = damping * mass / successors.size();
+        for(const Key& successor: successors)
+        {
+          double& next = residuals[successor];
+          double threshold = epsilon * std::max<size_t>(graph.find(successor)->second.size(), 1);
+          //queue it only when it goes over the threshold, if it already was
+          //it is in the queue
+          if(next <= threshold && next + share > threshold)
+            que.push(successor);
+          next += share;
+        }
+      }
+    }
+  }
+
+  /**
+   * Personalized pagerank of a single source by forward push (Andersen, Chung,
+   * Lang, "Local graph partitioning using PageRank vectors"). Each node has an
+   * estimate and a residual, the source starting with all the residual; a node
+   * whose residual is more than epsilon times its outdegree keeps 1 - damping of
+   * it as estimate and pushes the rest evenly to its successors (nodes without
+   * successors only keep their share, like in pprSingleSource). Every push
+   * settles at least (1 - damping) * epsilon of the residual, so the work is
+   * bounded by 1 / ((1 - damping) * epsilon) pushes whatever the size of the graph.
+   * When it ends the residual left at every node is at most epsilon times its
+   * outdegree, and each estimate is below the pagerank of the node by at most
+   * the sum of the residuals left (which also bounds the error summed over all
+   * the nodes), see pprInternal::pushForward.
+   * Scores are pagerank values, as the ones of pprSingleSource.
+   * @param graph   The graph, every node must be a key of the map.
+   * @param source  Node for which to calculate the ppr.
+   * @param K       Number of entries (nodes) to return, the top-K scoring ones.
+   * @param damping Damping factor, a la Pagerank, [0, 1).
+   * @param epsilon Residual threshold, lower is more accurate and slower.
+   * @return Map of the top-K scoring nodes of the source.
+   */
+  template<typename Key>
+  unordered_map<Key, double> forwardPush(const unordered_map<Key, vector<Key>>& graph, //the graph
+    Key source,//source node for which ppr is going to be computed
+    size_t K,//top-K to return
+    double damping,//damping factor
+    double epsilon)//residual threshold
+  {
+    //checking parameters
+    if(K == 0){cerr << "K must be positive" << endl; exit(EXIT_FAILURE);}
+    if(damping < 0 || damping >= 1){cerr << "damping must be [0,1)" << endl; exit(EXIT_FAILURE);}
+    if(epsilon <= 0){cerr << "epsilon must be positive" << endl; exit(EXIT_FAILURE);}
+    if(graph.find(source) == graph.end()){cerr << "source node not part of the graph" << endl; exit(EXIT_FAILURE);}
+
+    unordered_map<Key, double> estimates;
+    unordered_map<Key, double> residuals;
+    pprInternal::pushForward(graph, source, damping, epsilon, estimates, residuals);
+
+    keepTop(K, estimates);
+    return estimates;
+  }
+
+  /**
+   * Forward push (see above) for every node of the graph, in the same format
+   * of grank and mccompletepathv2.
+   * @param graph   The graph, every node must be a key of the map.
+   * @param K       Number of entries (nodes) for each source.
+   * @param damping Damping factor, a la Pagerank, [0, 1).
+   * @param epsilon Residual threshold, lower is more accurate and slower.
+   * @return Maps of each node, storing theirs personalized pagerank top-K basket.
+   */
+  template<typename Key>
+  unordered_map<Key, unordered_map<Key, double>> forwardPush(const unordered_map<Key, vector<Key>>& graph, //the graph
+    size_t K,//top-K of each node
+    double damping,//damping factor
+    double epsilon)//residual threshold
+  {
+    unordered_map<Key, unordered_map<Key, double>> res;
+    res.reserve(graph.size());
+    for(const auto& keyVal: graph)
+      res[keyVal.first] = forwardPush(graph, keyVal.first, K, damping, epsilon);
+    return res;
+  }
+
+  /**
+   * Sources for which a target scores the highest, by backward push over the
+   * transpose graph (see pprInternal::pushBackward): ppr(s, target) is
+   * estimated for every source s, underestimating it by less than epsilon, and
+   * the top-K sources are returned. The work depends on how much pagerank the
+   * target gets, not on the size of the graph.
+   * Scores are pagerank values, as the ones of pprSingleSource.
+   * @param graph        The graph, every node must be a key of the map.
+   * @param predecessors Transpose of the graph (see predecessorsOf), so that it
+   * can be built once for many targets.
+   * @param target       Node for which to find the sources.
+   * @param K            Number of sources to return, the top-K scoring ones.
+   * @param damping      Damping factor, a la Pagerank, [0, 1).
+   * @param epsilon      Residual threshold, lower is more accurate and slower.
+   * @return Map of the top-K sources, to their ppr score of the target.
+   */
+  template<typename Key>
+  unordered_map<Key, double> backwardPush(const unordered_map<Key, vector<Key>>& graph, //the graph
+    const unordered_map<Key, vector<Key>>& predecessors,//transpose of the graph
+    Key target,//target node for which sources are going to be found
+    size_t K,//top-K to return
+    double damping,//damping factor
+    double epsilon)//residual threshold
+  {
+    //checking parameters
+    if(K == 0){cerr << "K must be positive" << endl; exit(EXIT_FAILURE);}
+    if(damping < 0 || damping >= 1){cerr << "damping must be [0,1)" << endl; exit(EXIT_FAILURE);}
+    if(epsilon <= 0){cerr << "epsilon must be positive" << endl; exit(EXIT_FAILURE);}
+    if(graph.find(target) == graph.end()){cerr << "target node not part of the graph" << endl; exit(EXIT_FAILURE);}
+
+    unordered_map<Key, double> estimates;
+    unordered_map<Key, double> residuals;
+    pprInternal::pushBackward(graph, predecessors, target, damping, epsilon, estimates, residuals);
+    keepTop(K, estimates);
+    return estimates;
+  }
+
+  /**
+   * Backward push (see above), building the transpose of the graph.
+   */
+  template<typename Key>
+  unordered_map<Key, double> backwardPush(const unordered_map<Key, vector<Key>>& graph, //the graph
+    Key target,//target node for which sources are going to be found
+    size_t K,//top-K to return
+    double damping,//damping factor
+    double epsilon)//residual threshold
+  {
+    return backwardPush(graph, predecessorsOf(graph), target, K, damping, epsilon);
+  }
+
+  /**
+   * Estimate of a single ppr(source, target) score, bidirectional (Lofgren,
+   * Banerjee, Goel, "Personalized PageRank estimation and search: a bidirectional
+   * approach"). A backward push from the target (see pprInternal::pushBackward)
+   * leaves estimates p and residuals r with
+   * ppr(source, target) = p[source] + sum over v of ppr(source, v) * r[v],
+   * and the sum is estimated by random walks from the source, as the ones of
+   * mccompletepathv2: ppr(source, v) is 1 - damping times the expected visits
+   * of a walk to v, so each walk adds (1 - damping) * r[v] for each node v it
+   * visits (source included).
+   * Epsilon and walks are the accuracy/latency trade-off: the push costs more
+   * the lower epsilon is, while no residual is more than epsilon, so the error
+   * of the walks goes down with epsilon / sqrt(walks); epsilon around
+   * sqrt(1 / walks) times the smallest score of interest balances the two.
+   * Scores are pagerank values, as the ones of pprSingleSource.
+   * @param graph        The graph, every node must be a key of the map.
+   * @param predecessors Transpose of the graph (see predecessorsOf).
+   * @param source
+   * @param target
+   * @param damping      Damping factor, a la Pagerank, [0, 1).
+   * @param epsilon      Residual threshold of the backward push.
+   * @param walks        Random walks from the source.
+   * @param seed         Seed of the random walks, runs with the same seed give the same results.
+   * @return Estimate of ppr(source, target).
+   */
+  template<typename Key>
+  double bippr(const unordered_map<Key, vector<Key>>& graph, //the graph
+    const unordered_map<Key, vector<Key>>& predecessors,//transpose of the graph
+    Key source,//source node
+    Key target,//target node
+    double damping,//damping factor
+    double epsilon,//residual threshold
+    size_t walks,//random walks from the source
+    uint64_t seed)//seed of the random walks
+  {
+    //checking parameters
+    if(damping < 0 || damping >= 1){cerr << "damping must be [0,1)" << endl; exit(EXIT_FAILURE);}
+    if(epsilon <= 0){cerr << "epsilon must be positive" << endl; exit(EXIT_FAILURE);}
+    if(walks == 0){cerr << "walks must be positive" << endl; exit(EXIT_FAILURE);}
+    if(graph.find(source) == graph.end()){cerr << "source node not part of the graph" << endl; exit(EXIT_FAILURE);}
+    if(graph.find(target) == graph.end()){cerr << "target node not part of the graph" << endl; exit(EXIT_FAILURE);}
+
+    unordered_map<Key, double> estimates;
+    unordered_map<Key, double> residuals;
+    pprInternal::pushBackward(graph, predecessors, target, damping, epsilon, estimates, residuals);
+
+    auto it = estimates.find(source);
+    double estimate = (it == estimates.end())? 0 : it->second;
+
+    xoshiro256 generator(seed);
+    //edges walked are 1 + geometric minus the first one, which is taken
+    //with probability "damping" like the others
+    walkLength lengths(generator, damping);
+    double residualSum = 0;
+    for(size_t w = 0; w < walks; w++)
+    {
+      Key node = source;
+      for(size_t edges = lengths() - 1; ; edges--)
+      {
+        auto residual = residuals.find(node);
+        if(residual != residuals.end())
+          residualSum += residual->second;
+        const vector<Key>& successors = graph.find(node)->second;
+        if(edges == 0 || successors.empty())
+          break;
+        node = successors[generator() % successors.size()];
+      }
+    }
+    return estimate + (1.0 - damping) * residualSum / walks;
+  }
+
+  /**
+   * Bidirectional estimate (see above), building the transpose of the graph.
+   */
+  template<typename Key>
+  double bippr(const unordered_map<Key, vector<Key>>& graph, //the graph
+    Key source,//source node
+    Key target,//target node
+    double damping,//damping factor
+    double epsilon,//residual threshold
+    size_t walks,//random walks from the source
+    uint64_t seed)//seed of the random walks
+  {
+    return bippr(graph, predecessorsOf(graph), source, target, damping, epsilon, walks, seed);
+  }
+}
+#endif
@@ -0,0 +1,72 @@
+#ifndef BENCHUTILS_H
+#define BENCHUTILS_H
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdlib.h>//exit
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * Helpers shared by the benchmark programs.
+ */
+
+/**
+ * Parse arguments in the form name=value, the names must be the ones of the
+ * defaults (which are overwritten by the arguments).
+ * @param defaults Default value of each argument.
+ */
+inline std::unordered_map<std::string, std::string> parseArguments(int argc, char** argv,
+  std::unordered_map<std::string, std::string> defaults)
+{
+  for(int i = 1; i < argc; i++)
+  {
+    std::string argument = argv[i];
+    size_t equals = argument.find('=');
+    if(equals == std::string::npos || defaults.find(argument.substr(0, equals)) == defaults.end())
+    {
+      std::cerr << "unknown argument " << argument << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    defaults[argument.substr(0, equals)] = argument.substr(equals + 1);
+  }
+  return defaults;
+}
+
+/**
+ * Split a comma separated list.
+ */
+inline std::vector<std::string> splitList(const std::string& list)
+{
+  std::vector<std::string> items;
+  std::stringstream stream(list);
+  for(std::string item; getline(stream, item, ',');)
+    items.push_back(item);
+  return items;
+}
+
+/**
+ * Peak resident memory (VmHWM) of the process in MB, 0 where not available.
+ */
+inline double peakMemoryMB()
+{
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while(getline(status, line))
+    if(line.compare(0, 6, "VmHWM:") == 0)
+      return std::stod(line.substr(6)) / 1024;
+  return 0;
+}
+
+/**
+ * Reset the peak resident memory to the current one (Linux only), so that
+ * the peak of each run can be read on its own.
+ */
+inline void resetPeakMemory()
+{
+  std::ofstream clearRefs("/proc/self/clear_refs");
+  clearRefs << "5";
+}
+#endif
@@ -3,6 +3,7 @@
 #include <fstream>
 #include <functional>
 #include <iostream>
+#include <map>
 #include <sstream>
 #include <string>
 #include <unordered_map>
@@ -12,14 +13,44 @@
 #include <grankMulti.h>
 #include <kendall.h>
 #include <mccompletepathv2.h>
-#include <pprSingleSource.h>
+#include <memoryAccounting.h>
+
+#include "benchUtils.h"
 
 using namespace std;
 using ppr::benchmarkAlgorithm;
 using ppr::grank;
 using ppr::grankMulti;
 using ppr::mccompletepathv2;
-using ppr::pprInternal::pprSingleSource;
+using ppr::mccompletepathv2Multi;
+using ppr::runBudget;
+
+/*
+ * Benchmark of the algorithms on a graph from a csv file: every combination
+ * of the parameters is run a number of times, and for each run the load time
+ * of the graph, the compute time, the peak memory (with the one predicted
+ * before the run and, in the pprMemory build, the peak of each category of
+ * memoryAccounting.h) and the quality given by benchmarkAlgorithm are printed
+ * as json or csv. The results can be confronted
+ * with the ones of a previous run (the baseline), failing if the compute time
+ * or the jaccard average got worse by more than a threshold.
+ * Usage: ppr [name=value ...], with the names (and defaults):
+ *   graph=example.txt          csv file of the graph, one "node1, node2" edge per line
+ *   algorithms=grankMulti,grank,mc  among grank, grankMulti, mc, mcMulti
+ *   K=50 L=100                 comma separated lists make a grid, i.e. L=100,200
+ *   iterations=30              iterations of grank and grankMulti (list)
+ *   walks=1000                 walks of each node of mc and mcMulti (list)
+ *   damping=0.85 tolerance=0.0001  (lists)
+ *   threads=4                  threads of grankMulti and mcMulti (list)
+ *   repetitions=1              runs of each combination of the parameters
+ *   testNodes=200 strict=1     sample of benchmarkAlgorithm
+ *   seed=1                     seed of the sample and of the walks
+ *   timeout=0                  seconds after which a run stops with what it has, 0 for none
+ *   format=json                json or csv
+ *   output=                    file of the results, the standard output if empty
+ *   baseline=                  results (json or csv) of a previous run to confront with
+ *   threshold=0.1              worsening allowed, relative to the baseline
+ */
 
 /**
  * Imports a direct graph from a csv, every line is an edge in the form of:
@@ -27,51 +58,329 @@ using ppr::pprInternal::pprSingleSource;
  */
 unordered_map<int, vector<int>> importGraph(string fname);
 
-int main()
+//the pprMemory build accounts the memory of the algorithms to their phases and
+//categories, ppr does not so that its times are the ones of the algorithms alone
+#ifdef PPR_ACCOUNT_MEMORY
+PPR_MEMORY_ACCOUNTING
+#endif
+
+//a run of an algorithm with a combination of the parameters
+struct run
+{
+  string algorithm;
+  size_t K, L, iterations, threads, repetition;
+  double damping, tolerance;
+  double loadSeconds, computeSeconds, peakMB;
+  //predicted before the run and accounted peak of each category, in MB
+  double estimatedMB;
+  double categoryMB[ppr::memoryCategories];
+  //iterations done by grank and grankMulti, negative for mc
+  double convergedAfter;
+  //stopped by the timeout
+  bool stoppedEarly;
+  unordered_map<string, double> quality;
+
+  //the parameters, as a key for the baseline
+  string configuration() const
+  {
+    stringstream key;
+    key << algorithm << " K=" << K << " L=" << L << " iterations=" << iterations << " damping=" << damping
+      << " tolerance=" << tolerance << " threads=" << threads;
+    return key.str();
+  }
+};
+
+//counts the iterations of grank and grankMulti
+struct iterationCounter: public ppr::grankObserver
+{
+  size_t iterations = 0;
+  void iteration(const ppr::grankIteration&) { iterations++; }
+};
+
+//columns of the output, in order
+static const vector<string> columns = {"algorithm", "K", "L", "iterations", "damping", "tolerance", "threads",
+  "repetition", "load seconds", "compute seconds", "peak MB", "estimated MB", "graph MB", "scores MB", "scratch MB",
+  "iterations to convergence", "stopped early",
+  "jaccard average",
+  "jaccard min", "kendall average", "kendall min", "average map size"};
+
+//value of a column of a run, as text (empty if not known)
+static string column(const run& r, const string& name)
+{
+  stringstream value;
+  if(name == "algorithm") value << r.algorithm;
+  else if(name == "K") value << r.K;
+  else if(name == "L") value << r.L;
+  else if(name == "iterations") value << r.iterations;
+  else if(name == "damping") value << r.damping;
+  else if(name == "tolerance") value << r.tolerance;
+  else if(name == "threads") value << r.threads;
+  else if(name == "repetition") value << r.repetition;
+  else if(name == "load seconds") value << r.loadSeconds;
+  else if(name == "compute seconds") value << r.computeSeconds;
+  else if(name == "peak MB") value << r.peakMB;
+  else if(name == "estimated MB") value << r.estimatedMB;
+  else if(name == "graph MB") { if(r.categoryMB[ppr::memoryGraph] >= 0) value << r.categoryMB[ppr::memoryGraph]; }
+  else if(name == "scores MB") { if(r.categoryMB[ppr::memoryScores] >= 0) value << r.categoryMB[ppr::memoryScores]; }
+  else if(name == "scratch MB") { if(r.categoryMB[ppr::memoryScratch] >= 0) value << r.categoryMB[ppr::memoryScratch]; }
+  else if(name == "iterations to convergence") { if(r.convergedAfter >= 0) value << r.convergedAfter; }
+  else if(name == "stopped early") value << r.stoppedEarly;
+  else value << r.quality.find(name)->second;
+  return value.str();
+}
+
+static void writeJson(ostream& out, const vector<run>& runs)
+{
+  out << "[" << endl;
+  for(size_t i = 0; i < runs.size(); i++)
+  {
+    out << "  {";
+    for(size_t c = 0; c < columns.size(); c++)
+    {
+      string value = column(runs[i], columns[c]);
+      if(columns[c] == "algorithm")
+        value = "\"" + value + "\"";
+      else if(value.empty())
+        value = "null";
+      out << ((c > 0)? ", " : "") << "\"" << columns[c] << "\": " << value;
+    }
+    out << "}" << ((i + 1 < runs.size())? "," : "") << endl;
+  }
+  out << "]" << endl;
+}
+
+static void writeCsv(ostream& out, const vector<run>& runs)
+{
+  for(size_t c = 0; c < columns.size(); c++)
+    out << ((c > 0)? "," : "") << columns[c];
+  out << endl;
+  for(const run& r: runs)
+  {
+    for(size_t c = 0; c < columns.size(); c++)
+      out << ((c > 0)? "," : "") << column(r, columns[c]);
+    out << endl;
+  }
+}
+
+/**
+ * Read the results written by writeJson or writeCsv, as a map of column name
+ * to value (as text) for each run.
+ */
+static vector<unordered_map<string, string>> readResults(const string& path)
+{
+  ifstream in(path);
+  if(!in){cerr << "could not read the baseline " << path << endl; exit(EXIT_FAILURE);}
+  vector<unordered_map<string, string>> results;
+  string line;
+  vector<string> header;
+  while(getline(in, line))
+  {
+    line.erase(std::remove(line.begin(), line.end(), '\r'), line.end());
+    size_t open = line.find('{');
+    if(open != string::npos)
+    {
+      //a json run, "name": value pairs (no commas or quotes in names or values)
+      unordered_map<string, string> result;
+      stringstream pairs(line.substr(open + 1, line.rfind('}') - open - 1));
+      for(string pair; getline(pairs, pair, ',');)
+      {
+        size_t colon = pair.find(':');
+        auto trim = [](string s)
+        {
+          s.erase(std::remove(s.begin(), s.end(), '"'), s.end());
+          size_t first = s.find_first_not_of(' ');
+          return (first == string::npos)? string() : s.substr(first, s.find_last_not_of(' ') - first + 1);
+        };
+        string value = trim(pair.substr(colon + 1));
+        result[trim(pair.substr(0, colon))] = (value == "null")? "" : value;
+      }
+      results.push_back(result);
+    }
+    else if(line != "[" && line != "]" && !line.empty())
+    {
+      //a csv line, the first one is the header
+      vector<string> values = splitList(line);
+      if(header.empty())
+        header = values;
+      else
+      {
+        unordered_map<string, string> result;
+        for(size_t c = 0; c < header.size() && c < values.size(); c++)
+          result[header[c]] = values[c];
+        results.push_back(result);
+      }
+    }
+  }
+  return results;
+}
+
+/**
+ * Confront the runs with the baseline: for each combination of the parameters
+ * the average compute time and jaccard average of its repetitions must not be
+ * worse than the ones of the baseline by more than the threshold.
+ * @return Number of regressions found.
+ */
+static size_t compareWithBaseline(const vector<run>& runs, const string& path, double threshold)
+{
+  //configuration -> sum of compute seconds, sum of jaccard averages, runs
+  map<string, vector<double>> current, baseline;
+  for(const run& r: runs)
+  {
+    vector<double>& sums = current[r.configuration()];
+    sums.resize(3, 0);
+    sums[0] += r.computeSeconds; sums[1] += r.quality.find("jaccard average")->second; sums[2]++;
+  }
+  for(const auto& result: readResults(path))
+  {
+    auto get = [&result](const string& name)
+    {
+      auto it = result.find(name);
+      return (it == result.end())? string() : it->second;
+    };
+    run r;
+    r.algorithm = get("algorithm");
+    r.K = stoul(get("K")); r.L = stoul(get("L")); r.iterations = stoul(get("iterations"));
+    r.damping = stod(get("damping")); r.tolerance = stod(get("tolerance")); r.threads = stoul(get("threads"));
+    vector<double>& sums = baseline[r.configuration()];
+    sums.resize(3, 0);
+    sums[0] += stod(get("compute seconds")); sums[1] += stod(get("jaccard average")); sums[2]++;
+  }
+
+  size_t regressions = 0;
+  for(const auto& keyVal: current)
+  {
+    auto it = baseline.find(keyVal.first);
+    if(it == baseline.end())
+    {
+      cerr << "not in the baseline: " << keyVal.first << endl;
+      continue;
+    }
+    double seconds = keyVal.second[0] / keyVal.second[2];
+    double baseSeconds = it->second[0] / it->second[2];
+    double jaccard = keyVal.second[1] / keyVal.second[2];
+    double baseJaccard = it->second[1] / it->second[2];
+    if(seconds > baseSeconds * (1 + threshold))
+    {
+      cerr << "regression: " << keyVal.first << ": compute seconds " << seconds << ", baseline " << baseSeconds << endl;
+      regressions++;
+    }
+    if(jaccard < baseJaccard * (1 - threshold))
+    {
+      cerr << "regression: " << keyVal.first << ": jaccard average " << jaccard << ", baseline " << baseJaccard << endl;
+      regressions++;
+    }
+  }
+  return regressions;
+}
+
+int main(int argc, char** argv)
 {
-  unordered_map<int, vector<int>> graph = importGraph("example.txt");
+  unordered_map<string, string> arguments = parseArguments(argc, argv, {{"graph", "example.txt"},
+    {"algorithms", "grankMulti,grank,mc"}, {"K", "50"}, {"L", "100"}, {"iterations", "30"}, {"walks", "1000"},
+    {"damping", "0.85"}, {"tolerance", "0.0001"}, {"threads", "4"}, {"repetitions", "1"}, {"testNodes", "200"},
+    {"strict", "1"}, {"seed", "1"}, {"timeout", "0"}, {"format", "json"}, {"output", ""}, {"baseline", ""}, {"threshold", "0.1"}});
+  string format = arguments["format"];
+  if(format != "json" && format != "csv"){cerr << "format must be json or csv" << endl; exit(EXIT_FAILURE);}
+  size_t repetitions = stoul(arguments["repetitions"]);
+  size_t testNodes = stoul(arguments["testNodes"]);
+  bool strict = stoul(arguments["strict"]) != 0;
+  uint64_t seed = stoull(arguments["seed"]);
+  double timeout = stod(arguments["timeout"]);
+  auto numbers = [&arguments](const string& name)
+  {
+    vector<double> values;
+    for(const string& value: splitList(arguments[name]))
+      values.push_back(stod(value));
+    return values;
+  };
 
-  //grank multi
+  auto begin = chrono::steady_clock::now();
+  unordered_map<int, vector<int>> graph;
   {
-    auto begin = std::chrono::steady_clock::now();
-    auto map = grankMulti(graph, 50, 100, 30, 0.85, 0.0001, 4);
-    auto end= std::chrono::steady_clock::now();
-    std::cout << "grank run-time = " << std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count() << " ms" << endl;
-    auto bench = benchmarkAlgorithm(map, graph, 200, true);
-    cout << "-------" << endl;
-    for(auto& keyVal: bench)
-      cout << keyVal.first << "     " << keyVal.second << endl;
-    cout << "-------" << endl;
+    ppr::memoryScope scope(ppr::memoryGraph);
+    graph = importGraph(arguments["graph"]);
   }
+  double loadSeconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+  size_t edges = 0;
+  for(const auto& keyVal: graph)
+    edges += keyVal.second.size();
 
-  //grank
+  vector<run> runs;
+  for(const string& algorithm: splitList(arguments["algorithms"]))
   {
-    auto begin = std::chrono::steady_clock::now();
-    auto map = grank(graph, 50, 100, 30, 0.85, 0.0001);
-    auto end= std::chrono::steady_clock::now();
-    std::cout << "grank run-time = " << std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count() << " ms" << endl;
-
-    auto bench = benchmarkAlgorithm(map, graph, 200, true);
-    cout << "-------" << endl;
-    for(auto& keyVal: bench)
-      cout << keyVal.first << "     " << keyVal.second << endl;
-    cout << "-------" << endl;
+    bool multi = algorithm == "grankMulti" || algorithm == "mcMulti";
+    bool mc = algorithm == "mc" || algorithm == "mcMulti";
+    if(!mc && !multi && algorithm != "grank"){cerr << "unknown algorithm " << algorithm << endl; exit(EXIT_FAILURE);}
+    for(double K: numbers("K"))
+    for(double L: numbers("L"))
+    for(double iterations: numbers(mc? "walks" : "iterations"))
+    for(double damping: numbers("damping"))
+    for(double tolerance: (mc? vector<double>{0} : numbers("tolerance")))
+    for(double threads: (multi? numbers("threads") : vector<double>{1}))
+    for(size_t repetition = 0; repetition < repetitions; repetition++)
+    {
+      if(K > L)
+      {
+        cerr << "skipping K=" << K << " L=" << L << ", K must be <= L" << endl;
+        continue;
+      }
+      run r;
+      r.algorithm = algorithm; r.K = K; r.L = L; r.iterations = iterations; r.damping = damping;
+      r.tolerance = tolerance; r.threads = threads; r.repetition = repetition; r.loadSeconds = loadSeconds;
+      r.convergedAfter = -1;
+      ppr::memoryEstimate estimate = mc? ppr::mccompletepathv2MemoryEstimate<int>(graph.size(), edges, r.L) :
+        ppr::grankMemoryEstimate<int>(graph.size(), edges, r.L);
+      r.estimatedMB = estimate.total / 1048576.0;
+
+      ppr::clearMemoryPhases();
+      resetPeakMemory();
+      begin = chrono::steady_clock::now();
+      unordered_map<int, unordered_map<int, double>> map;
+      iterationCounter counter;
+      runBudget budget;
+      if(timeout > 0)
+        budget.setTimeout(timeout);
+      if(algorithm == "grank")
+        map = grank(graph, r.K, r.L, r.iterations, damping, tolerance, &counter, &budget);
+      else if(algorithm == "grankMulti")
+        map = grankMulti(graph, r.K, r.L, r.iterations, damping, tolerance, r.threads, &counter, &budget);
+      else if(algorithm == "mc")
+        map = mccompletepathv2(graph, r.K, r.L, r.iterations, damping, seed, nullptr, nullptr, nullptr, &budget);
+      else
+        map = mccompletepathv2Multi(graph, r.K, r.L, r.iterations, damping, r.threads, seed, nullptr, &budget);
+      r.stoppedEarly = budget.stoppedEarly();
+      r.computeSeconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+      r.peakMB = peakMemoryMB();
+      //grankMulti has no phase and ppr has no accounting, the categories are then left empty
+      for(size_t c = 0; c < ppr::memoryCategories; c++)
+        r.categoryMB[c] = -1;
+      for(const ppr::memoryPhaseReport& phase: ppr::memoryPhases())
+        if(phase.name == "grank" || phase.name == "mccompletepathv2" || phase.name == "mccompletepathv2Multi")
+          for(size_t c = 0; c < ppr::memoryCategories; c++)
+            r.categoryMB[c] = phase.peak[c] / 1048576.0;
+      if(!mc)
+        r.convergedAfter = counter.iterations;
+
+      r.quality = benchmarkAlgorithm(map, graph, testNodes, strict, max<size_t>(1, r.threads), seed, nullptr);
+      runs.push_back(r);
+    }
   }
 
-  //mc
+  ofstream file;
+  if(!arguments["output"].empty())
   {
-    auto begin = std::chrono::steady_clock::now();
-    auto map = mccompletepathv2<int>(graph, 50, 200, 1000, 0.85);
-    auto end = std::chrono::steady_clock::now();
-    std::cout << "mc run-time = " << std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count() << " ms" << endl;
-
-    auto bench = benchmarkAlgorithm(map, graph, 200, true);
-    cout << "-------" << endl;
-    for(auto& keyVal: bench)
-      cout << keyVal.first << "     " << keyVal.second << endl;
-    cout << "-------" << endl;
+    file.open(arguments["output"]);
+    if(!file){cerr << "could not write " << arguments["output"] << endl; exit(EXIT_FAILURE);}
   }
-  //*/
+  ostream& out = arguments["output"].empty()? cout : file;
+  if(format == "json")
+    writeJson(out, runs);
+  else
+    writeCsv(out, runs);
+
+  if(!arguments["baseline"].empty() &&
+    compareWithBaseline(runs, arguments["baseline"], stod(arguments["threshold"])) > 0)
+    return EXIT_FAILURE;
   return 0;
 }
 
@@ -79,6 +388,7 @@ unordered_map<int, vector<int>> importGraph(string fname)
 {
   size_t edgeCounter = 0;
   ifstream inputFile(fname, ifstream::in);
+  if(!inputFile){cerr << "could not read the graph " << fname << endl; exit(EXIT_FAILURE);}
   unordered_map<int, vector<int>> graph;
 
   //needed for repeating edges
@@ -106,7 +416,7 @@ unordered_map<int, vector<int>> importGraph(string fname)
       edgeCounter++;
     }
   }
-  cout << "nodes: " << graph.size() << " edges: " << edgeCounter << endl;
+  cerr << "nodes: " << graph.size() << " edges: " << edgeCounter << endl;
 
   return graph;
 }
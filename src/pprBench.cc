@@ -0,0 +1,227 @@
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <kendall.h>
+#include <mccompletepathv2.h>
+#include <memoryAccounting.h>
+#include <pprGraph.h>
+#include <pprInternal.h>
+
+using namespace std;
+using ppr::pprInternal::combineSuccessors;
+using ppr::pprInternal::jaccard;
+using ppr::pprInternal::keepTop;
+using ppr::pprInternal::makeDenseGraph;
+using ppr::pprInternal::noSlot;
+using ppr::pprInternal::norm1;
+using ppr::pprInternal::walkNode;
+using ppr::pprInternal::xoshiro256;
+
+/*
+ * Microbenchmarks of the kernels the algorithms spend their time in, each
+ * one with a few sizes (L, outdegree) and key types. For each kernel and
+ * parameters the time and the bytes allocated by a single call are reported,
+ * with the throughput in items (map entries, walks...) per second.
+ * Usage: pprBench [filter], only the benchmarks whose name contains the
+ * filter are run.
+ */
+
+//counts the bytes allocated by each call, without slowing down the allocations
+//as PPR_MEMORY_ACCOUNTING would
+PPR_MEMORY_COUNTING
+
+//results are added here so that the kernels are not optimised away
+static volatile double sink = 0;
+
+//seconds each benchmark runs for, at least
+static const double minSeconds = 0.2;
+
+/**
+ * Run "op" until minSeconds have passed, calling "setup" (not timed) before
+ * each call, and print the time and the bytes allocated per call.
+ * @param name   Name of the kernel.
+ * @param params Parameters, printed after the name.
+ * @param items  Items processed by each call, for the throughput.
+ */
+template<typename Setup, typename Op>
+void measure(const string& name, const string& params, double items, Setup setup, Op op)
+{
+  //warm up, so that the caches and the allocator are in their steady state
+  setup();
+  op();
+
+  size_t calls = 0;
+  double nanoseconds = 0;
+  size_t bytes = 0;
+  while(nanoseconds < minSeconds * 1e9)
+  {
+    setup();
+    size_t bytesBefore = ppr::allocatedMemory();
+    auto begin = chrono::steady_clock::now();
+    op();
+    auto end = chrono::steady_clock::now();
+    bytes += ppr::allocatedMemory() - bytesBefore;
+    nanoseconds += chrono::duration<double, std::nano>(end - begin).count();
+    calls++;
+  }
+  double perCall = nanoseconds / calls;
+  printf("%-10s %-28s %14.1f ns/op %12.1f B/op %14.0f items/s\n", name.c_str(), params.c_str(), perCall,
+    static_cast<double>(bytes) / calls, items / perCall * 1e9);
+}
+
+template<typename Key>
+Key makeKey(size_t i);
+
+template<>
+int makeKey<int>(size_t i) { return static_cast<int>(i); }
+
+template<>
+string makeKey<string>(size_t i) { return "node" + to_string(i); }
+
+template<typename Key>
+const char* keyName();
+
+template<>
+const char* keyName<int>() { return "int"; }
+
+template<>
+const char* keyName<string>() { return "string"; }
+
+//map of "size" entries with keys taken from [0, range) and random scores
+template<typename Key>
+unordered_map<Key, double> randomMap(size_t size, size_t range, xoshiro256& generator)
+{
+  unordered_map<Key, double> map;
+  while(map.size() < size)
+    map[makeKey<Key>(generator() % range)] = generator.nextDouble();
+  return map;
+}
+
+template<typename Key>
+void benchMaps(const string& filter, size_t L, xoshiro256& generator)
+{
+  string params = string(keyName<Key>()) + " L=" + to_string(L);
+
+  if(string("keepTop").find(filter) != string::npos)
+  {
+    //keep the top L of a map of 2L entries, as grank does after combining
+    unordered_map<Key, double> base = randomMap<Key>(2 * L, 8 * L, generator);
+    unordered_map<Key, double> map;
+    measure("keepTop", params, 2 * L, [&]() { map = base; }, [&]() { keepTop(L, map); sink = sink + map.size(); });
+  }
+
+  if(string("norm1").find(filter) != string::npos)
+  {
+    unordered_map<Key, double> m1 = randomMap<Key>(L, 2 * L, generator);
+    unordered_map<Key, double> m2 = randomMap<Key>(L, 2 * L, generator);
+    measure("norm1", params, 2 * L, []() {}, [&]() { sink = sink + norm1(m1, m2); });
+  }
+
+  if(string("jaccard").find(filter) != string::npos)
+  {
+    unordered_set<Key> s1, s2;
+    for(const auto& keyVal: randomMap<Key>(L, 2 * L, generator))
+      s1.insert(keyVal.first);
+    for(const auto& keyVal: randomMap<Key>(L, 2 * L, generator))
+      s2.insert(keyVal.first);
+    measure("jaccard", params, 2 * L, []() {}, [&]() { sink = sink + jaccard(s1, s2); });
+  }
+}
+
+template<typename Key>
+void benchCombine(const string& filter, size_t L, size_t outdegree, xoshiro256& generator)
+{
+  if(string("combine").find(filter) == string::npos)
+    return;
+  string params = string(keyName<Key>()) + " L=" + to_string(L) + " d=" + to_string(outdegree);
+
+  //maps of the successors, with overlapping keys as in a real neighbourhood
+  unordered_map<Key, unordered_map<Key, double>> scores;
+  vector<Key> successors;
+  for(size_t i = 0; i < outdegree; i++)
+  {
+    successors.push_back(makeKey<Key>(i));
+    scores[successors.back()] = randomMap<Key>(L, 4 * L, generator);
+  }
+  unordered_map<Key, double> old = randomMap<Key>(L, 4 * L, generator);
+
+  //one step of grank for a node: combine, keep the top L, norm-1 with the old map
+  measure("combine", params, outdegree * L, []() {}, [&]()
+  {
+    unordered_map<Key, double> map;
+    map.reserve(L);
+    map.insert(make_pair(makeKey<Key>(0), 0.15));
+    combineSuccessors(scores, successors, 0.85 / outdegree, map);
+    keepTop(L, map);
+    sink = sink + norm1(map, old);
+  });
+}
+
+void benchKendall(const string& filter, size_t L, xoshiro256& generator)
+{
+  if(string("kendall").find(filter) == string::npos)
+    return;
+  vector<double> x(L), y(L);
+  for(size_t i = 0; i < L; i++)
+  {
+    x[i] = generator.nextDouble();
+    y[i] = x[i] + 0.1 * generator.nextDouble();
+  }
+  measure("kendall", "L=" + to_string(L), L, []() {}, [&]() { sink = sink + kendallCorrelation(x, y); });
+}
+
+void benchWalkNode(const string& filter, size_t L, size_t outdegree, xoshiro256& generator)
+{
+  if(string("walkNode").find(filter) == string::npos)
+    return;
+  const size_t n = 100000;
+  const size_t walks = 1000;
+  unordered_map<int, vector<int>> graph;
+  for(size_t i = 0; i < n; i++)
+    for(size_t e = 0; e < outdegree; e++)
+      graph[i].push_back(generator() % n);
+  auto dense = makeDenseGraph(graph);
+
+  vector<size_t> index(n, 0);
+  vector<size_t> slots(n, noSlot);
+  vector<size_t> touched;
+  xoshiro256 walkGenerator(generator());
+  measure("walkNode", "L=" + to_string(L) + " d=" + to_string(outdegree), walks, []() {}, [&]()
+  {
+    auto map = walkNode(dense, index, slots, generator() % n, L, 0.85, walks, walkGenerator, &touched, nullptr);
+    for(size_t node: touched)
+      index[node] = 0;
+    touched.clear();
+    sink = sink + map.size();
+  });
+}
+
+int main(int argc, char** argv)
+{
+  string filter = (argc > 1)? argv[1] : "";
+  xoshiro256 generator(42);
+  printf("%-10s %-28s %17s %15s %22s\n", "kernel", "parameters", "time", "allocated", "throughput");
+
+  for(size_t L: {10, 100, 1000})
+  {
+    benchMaps<int>(filter, L, generator);
+    benchMaps<string>(filter, L, generator);
+    benchKendall(filter, L, generator);
+  }
+  for(size_t L: {10, 100, 1000})
+    for(size_t outdegree: {2, 8, 32})
+    {
+      benchCombine<int>(filter, L, outdegree, generator);
+      benchCombine<string>(filter, L, outdegree, generator);
+    }
+  for(size_t L: {10, 100})
+    for(size_t outdegree: {2, 8, 32})
+      benchWalkNode(filter, L, outdegree, generator);
+  return 0;
+}
@@ -0,0 +1,122 @@
+#include <algorithm>//max
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <graphGenerators.h>
+#include <grank.h>
+#include <grankMulti.h>
+#include <mccompletepathv2.h>
+
+#include "benchUtils.h"
+
+using namespace std;
+
+/*
+ * Scaling benchmark: generates graphs of growing size with one of the
+ * generators of graphGenerators.h and runs grank, grankMulti and
+ * mccompletepathv2 on each of them, printing a csv line with the time and the
+ * peak memory of each run.
+ * Usage: scalingBench [name=value ...], with the names (and defaults):
+ *   generator=rmat   rmat, er, ba, grid or dag
+ *   minEdges=10000   edges of the first graph
+ *   maxEdges=1000000 edges of the last graph (up to 10^8 and more, given the memory)
+ *   factor=10        growth of the edges from a graph to the next
+ *   degree=16        average outdegree of the graphs
+ *   algorithms=grank,grankMulti,mc
+ *   threads=(hardware threads) threads of grankMulti and of the generators
+ *   K=50 L=100 iterations=30 walks=100 seed=1
+ */
+
+static unordered_map<int, vector<int>> generate(const string& generator, size_t edges, size_t degree,
+  uint64_t seed, size_t threads)
+{
+  size_t nodes = max<size_t>(1, edges / degree);
+  if(generator == "rmat")
+  {
+    size_t scale = 0;
+    while((size_t(1) << (scale + 1)) <= nodes)
+      scale++;
+    return ppr::rmatGraph<int>(scale, edges, 0.57, 0.19, 0.19, seed, threads);
+  }
+  if(generator == "er")
+    return ppr::erdosRenyiGraph<int>(nodes, static_cast<double>(min(degree, nodes)), seed, threads);
+  if(generator == "ba")
+    return ppr::barabasiAlbertGraph<int>(nodes, degree, seed, threads);
+  if(generator == "grid")
+  {
+    //about 4 edges for each node
+    size_t side = max<size_t>(1, static_cast<size_t>(sqrt(edges / 4.0)));
+    return ppr::gridGraph<int>(side, side);
+  }
+  if(generator == "dag")
+    return ppr::dagGraph<int>(nodes, degree, seed, threads);
+  cerr << "unknown generator " << generator << endl;
+  exit(EXIT_FAILURE);
+}
+
+int main(int argc, char** argv)
+{
+  unordered_map<string, string> arguments = parseArguments(argc, argv, {{"generator", "rmat"},
+    {"minEdges", "10000"}, {"maxEdges", "1000000"}, {"factor", "10"}, {"degree", "16"},
+    {"algorithms", "grank,grankMulti,mc"}, {"threads", to_string(max(1u, thread::hardware_concurrency()))},
+    {"K", "50"}, {"L", "100"}, {"iterations", "30"}, {"walks", "100"}, {"seed", "1"}});
+  size_t minEdges = stod(arguments["minEdges"]);
+  size_t maxEdges = stod(arguments["maxEdges"]);
+  double factor = stod(arguments["factor"]);
+  size_t degree = stoul(arguments["degree"]);
+  size_t threads = stoul(arguments["threads"]);
+  size_t K = stoul(arguments["K"]);
+  size_t L = stoul(arguments["L"]);
+  size_t iterations = stoul(arguments["iterations"]);
+  size_t walks = stoul(arguments["walks"]);
+  uint64_t seed = stoull(arguments["seed"]);
+  if(factor <= 1 || degree == 0 || threads == 0)
+  {
+    cerr << "factor must be greater than 1, degree and threads positive" << endl;
+    exit(EXIT_FAILURE);
+  }
+  vector<string> algorithms = splitList(arguments["algorithms"]);
+
+  cout << "generator,nodes,edges,algorithm,threads,generate seconds,seconds,peak MB" << endl;
+  for(double target = minEdges; target <= maxEdges; target *= factor)
+  {
+    auto begin = chrono::steady_clock::now();
+    unordered_map<int, vector<int>> graph = generate(arguments["generator"], static_cast<size_t>(target), degree,
+      seed, threads);
+    double generateSeconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    size_t edges = 0;
+    for(const auto& keyVal: graph)
+      edges += keyVal.second.size();
+
+    for(const string& algorithm: algorithms)
+    {
+      resetPeakMemory();
+      size_t baskets = 0;
+      begin = chrono::steady_clock::now();
+      if(algorithm == "grank")
+        baskets = ppr::grank(graph, K, L, iterations, 0.85, 0.0001).size();
+      else if(algorithm == "grankMulti")
+        baskets = ppr::grankMulti(graph, K, L, iterations, 0.85, 0.0001, threads).size();
+      else if(algorithm == "mc")
+        baskets = ppr::mccompletepathv2(graph, K, L, walks, 0.85, seed).size();
+      else
+      {
+        cerr << "unknown algorithm " << algorithm << endl;
+        exit(EXIT_FAILURE);
+      }
+      double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+      cout << arguments["generator"] << "," << graph.size() << "," << edges << "," << algorithm << ","
+        << ((algorithm == "grankMulti")? threads : 1) << "," << generateSeconds << "," << seconds << ","
+        << peakMemoryMB() << endl;
+      if(baskets != graph.size())
+        cerr << algorithm << " returned " << baskets << " baskets for " << graph.size() << " nodes" << endl;
+    }
+  }
+  return 0;
+}
@@ -2,17 +2,22 @@
 #include <unordered_map>
 #include <vector>
 #include <stdlib.h>//exit
+#include <cstdio>//remove
 
 #include <gtest.h>
 #include <gtest-spi.h>
 #include <benchmarkAlgorithm.h>
 #include <pprSingleSource.h>
 #include <grank.h>
+#include <graphGenerators.h>
 
 using namespace std;
 using ppr::pprInternal::pprSingleSource;
+using ppr::erdosRenyiGraph;
 using ppr::grank;
 using ppr::benchmarkAlgorithm;
+using ppr::benchmarkCache;
+using ppr::pprInternal::pagerankCache;
 
 extern random_device rd;
 extern default_random_engine eng;
@@ -23,6 +28,10 @@ TEST(benchmarkAlgorithm, badParameters)
   unordered_map<int, vector<int>> graph;
   auto gr = grank(graph, 1, 3, 42, 0.5, 0.0001);
   ASSERT_EXIT(benchmarkAlgorithm(gr, graph, 0, false), ::testing::ExitedWithCode(EXIT_FAILURE), "testNodes must be positive");
+  ASSERT_EXIT(benchmarkAlgorithm(gr, graph, 1, false, 0), ::testing::ExitedWithCode(EXIT_FAILURE), "nThreads must be positive");
+  benchmarkCache cache;
+  ASSERT_EXIT(benchmarkAlgorithm(gr, graph, 1, false, 1, 42, &cache), ::testing::ExitedWithCode(EXIT_FAILURE),
+    "cache path must not be empty");
 
   //gr containing nodes that aren't in graph
   gr[5];
@@ -158,3 +167,78 @@ TEST(benchmarkAlgorithm, compareHalfJaccard)
   ASSERT_NEAR(res["jaccard average"], 0.5, 10e-5);
   ASSERT_NEAR(res["jaccard min"], 0.5, 10e-5);
 }
+
+TEST(benchmarkAlgorithm, threadsSameAsSequential)
+{
+  unordered_map<int, vector<int>> graph;
+  for(int i = 0; i < 200; i++)
+  {
+    graph[i];
+    for(int e = 0, edges = dis(eng) % 5; e < edges; e++)
+      graph[i].push_back(dis(eng) % 200);
+  }
+  auto gr = grank(graph, 10, 20, 3, 0.85, 0.0001);
+
+  //every node is a sample, so that only the order of the samples changes between runs
+  auto sequential = benchmarkAlgorithm(gr, graph, 1000, false);
+  for(size_t nThreads: {2, 3, 8, 64})
+  {
+    auto parallel = benchmarkAlgorithm(gr, graph, 1000, false, nThreads);
+    ASSERT_EQ(parallel.size(), sequential.size());
+    for(const auto& keyVal: sequential)
+      ASSERT_NEAR(parallel[keyVal.first], keyVal.second, 1e-12);
+  }
+}
+
+TEST(benchmarkAlgorithm, sameSeedSameSample)
+{
+  auto graph = erdosRenyiGraph<int>(300, 2, dis(eng), 1);
+  auto gr = grank(graph, 10, 20, 2, 0.85, 0.0001);
+
+  auto first = benchmarkAlgorithm(gr, graph, 20, true, 1, 42, nullptr);
+  ASSERT_EQ(first, benchmarkAlgorithm(gr, graph, 20, true, 4, 42, nullptr));
+  //the same maps built in another order
+  unordered_map<int, vector<int>> graphCopy(graph.begin(), graph.end());
+  unordered_map<int, unordered_map<int, double>> grCopy(gr.begin(), gr.end());
+  ASSERT_EQ(first, benchmarkAlgorithm(grCopy, graphCopy, 20, true, 1, 42, nullptr));
+}
+
+TEST(benchmarkAlgorithm, cache)
+{
+  auto graph = erdosRenyiGraph<int>(300, 2, dis(eng), 1);
+  auto gr = grank(graph, 10, 20, 2, 0.85, 0.0001);
+  const char* path = "benchmarkAlgorithmTest.bin";
+  remove(path);
+  benchmarkCache cache;
+  cache.path = path;
+
+  //the cache is written, then read, with the same results
+  auto noCache = benchmarkAlgorithm(gr, graph, 30, false, 1, 7, nullptr);
+  ASSERT_EQ(noCache, benchmarkAlgorithm(gr, graph, 30, false, 2, 7, &cache));
+  pagerankCache file;
+  auto dense = ppr::pprInternal::makeDenseGraph(graph);
+  ASSERT_TRUE(file.load(path, ppr::pprInternal::fingerprint(dense), dense.size(), 100, 0.85, 0.0001, 0));
+  ASSERT_EQ(file.scores.size(), 30);
+  ASSERT_EQ(noCache, benchmarkAlgorithm(gr, graph, 30, false, 2, 7, &cache));
+
+  //other samples are added
+  auto otherSeed = benchmarkAlgorithm(gr, graph, 30, false, 1, 8, nullptr);
+  ASSERT_EQ(otherSeed, benchmarkAlgorithm(gr, graph, 30, false, 1, 8, &cache));
+  ASSERT_TRUE(file.load(path, ppr::pprInternal::fingerprint(dense), dense.size(), 100, 0.85, 0.0001, 0));
+  ASSERT_GT(file.scores.size(), 30);
+
+  //the cache of another graph is not used
+  graph[0].push_back(1);
+  auto changed = benchmarkAlgorithm(gr, graph, 30, false, 1, 7, nullptr);
+  ASSERT_EQ(changed, benchmarkAlgorithm(gr, graph, 30, false, 1, 7, &cache));
+
+  //only the top nodes are kept, the same ones on the first and the next runs
+  cache.topN = 15;
+  auto top = benchmarkAlgorithm(gr, graph, 30, false, 1, 7, &cache);
+  ASSERT_EQ(top, benchmarkAlgorithm(gr, graph, 30, false, 1, 7, &cache));
+  dense = ppr::pprInternal::makeDenseGraph(graph);
+  ASSERT_TRUE(file.load(path, ppr::pprInternal::fingerprint(dense), dense.size(), 100, 0.85, 0.0001, 15));
+  for(const auto& keyVal: file.scores)
+    ASSERT_LE(keyVal.second.size(), 15);
+  remove(path);
+}
@@ -0,0 +1,102 @@
+#include <unordered_set>
+#include <unordered_map>
+#include <vector>
+#include <stdlib.h>//exit
+#include <random>
+
+#include <gtest.h>
+#include <gtest-spi.h>
+#include <grank.h>
+#include <../header-only/grankMulti.h>
+
+using namespace std;
+using ppr::grank;
+using ppr::grankMulti;
+using ppr::grankMultiNuma;
+using ppr::numaReport;
+
+extern std::random_device rd;
+extern std::default_random_engine eng;
+extern std::uniform_int_distribution<unsigned long long> dis;
+
+TEST(grankMultiNuma, badParameters)
+{
+  unordered_map<int, vector<int>> graph;
+  ASSERT_EXIT(grankMultiNuma(graph, 0, 3, 42, 0.5, 0.0001, 4, 0, nullptr), ::testing::ExitedWithCode(EXIT_FAILURE), "K must be positive");
+  ASSERT_EXIT(grankMultiNuma(graph, 2, 0, 32, 0.85, 0.0001, 4, 0, nullptr), ::testing::ExitedWithCode(EXIT_FAILURE), "L must be positive");
+  ASSERT_EXIT(grankMultiNuma(graph, 2, 1, 10, 0.5, 0.0001, 4, 0, nullptr), ::testing::ExitedWithCode(EXIT_FAILURE), "K must be <= L");
+  ASSERT_EXIT(grankMultiNuma(graph, 2, 2, 0, 0.5, 0.0001, 4, 0, nullptr), ::testing::ExitedWithCode(EXIT_FAILURE), "iterations must be positive");
+  ASSERT_EXIT(grankMultiNuma(graph, 2, 2, 10, 1.5, 0.0001, 4, 0, nullptr), ::testing::ExitedWithCode(EXIT_FAILURE), "damping must be \\[0,1]");
+  ASSERT_EXIT(grankMultiNuma(graph, 2, 2, 10, 0.6, 0.0001, 0, 0, nullptr), ::testing::ExitedWithCode(EXIT_FAILURE), "nThreads must be positive");
+}
+
+TEST(grankMultiNuma, emptyGraph)
+{
+  unordered_map<int, vector<int>> graph;
+  numaReport report;
+  auto res =  grankMultiNuma(graph, 10, 30, 100, 0.85, 0.0001, 4, 2, &report);
+  ASSERT_EQ(res.size(), 0);
+  ASSERT_EQ(report.localAccesses + report.remoteAccesses, 0);
+  ASSERT_EQ(report.remoteRatio, 0);
+}
+
+TEST(grankMultiNuma, sameAsGrankMulti)
+{
+  unordered_map<int, vector<int>> graph;
+  for(int i = 0; i < 300; i++)
+    graph[i];
+  for(int i = 0; i < 1500; i++)
+    graph[dis(eng)%300].push_back(dis(eng)%300);
+
+  auto gr =  grank(graph, 30, 60, 50, 0.85, -1);
+  auto grM =  grankMulti(graph, 30, 60, 50, 0.85, -1, 4);
+  //machine topology, a single simulated node and more nodes than the machine has
+  for(size_t nodes: {0, 1, 2, 4})
+  {
+    auto grN = grankMultiNuma(graph, 30, 60, 50, 0.85, -1, 4, nodes, nullptr);
+    ASSERT_EQ(grN.size(), graph.size());
+    for(int i = 0; i < 300; i++)
+    {
+      ASSERT_EQ(grM[i].size(), grN[i].size());
+      ASSERT_EQ(gr[i].size(), grN[i].size());
+      for(const auto& keyVal: grM[i])
+        ASSERT_NEAR(keyVal.second, grN[i][keyVal.first], 10e-5);
+    }
+  }
+}
+
+TEST(grankMultiNuma, singleNodeHasNoRemoteAccesses)
+{
+  unordered_map<int, vector<int>> graph;
+  for(int i = 0; i < 100; i++)
+    graph[i].push_back((i + 1) % 100);
+
+  numaReport report;
+  grankMultiNuma(graph, 10, 20, 10, 0.85, -1, 4, 1, &report);
+  ASSERT_EQ(report.numaNodes, 1);
+  ASSERT_GT(report.localAccesses, 0);
+  ASSERT_EQ(report.remoteAccesses, 0);
+  ASSERT_EQ(report.remoteRatio, 0);
+}
+
+TEST(grankMultiNuma, simulatedNodes)
+{
+  unordered_map<int, vector<int>> graph;
+  for(int i = 0; i < 200; i++)
+    graph[i];
+  for(int i = 0; i < 1000; i++)
+    graph[dis(eng)%200].push_back(dis(eng)%200);
+
+  numaReport report;
+  grankMultiNuma(graph, 10, 20, 10, 0.85, -1, 4, 2, &report);
+  ASSERT_EQ(report.numaNodes, 2);
+  ASSERT_GT(report.remoteAccesses, 0);
+  ASSERT_GT(report.remoteRatio, 0);
+  ASSERT_LT(report.remoteRatio, 1);
+  ASSERT_NEAR(report.remoteRatio,
+    static_cast<double>(report.remoteAccesses) / (report.localAccesses + report.remoteAccesses), 10e-9);
+
+  //there can't be more NUMA nodes than threads
+  grankMultiNuma(graph, 10, 20, 10, 0.85, -1, 2, 8, &report);
+  ASSERT_EQ(report.numaNodes, 2);
+}
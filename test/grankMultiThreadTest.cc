@@ -13,6 +13,9 @@
 using namespace std;
 using ppr::grankMulti;
 using ppr::grank;
+using ppr::grankIteration;
+using ppr::grankObserver;
+using ppr::runBudget;
 using ppr::pprInternal::pprSingleSource;
 
 extern std::random_device rd;
@@ -574,3 +577,75 @@ TEST(grankMultiThread, singleThreadSameAsGrank4)
       ASSERT_NEAR(gr[i][u], grM[i][u], 10e-5);
   }
 }
+
+TEST(grankMultiThread, observerSameAsGrank)
+{
+  struct iterationRecorder: public grankObserver
+  {
+    vector<grankIteration> iterations;
+    void iteration(const grankIteration& stats) { iterations.push_back(stats); }
+  };
+
+  unordered_map<int, vector<int>> graph;
+  int n = 200;
+  for(int i = 0; i < n; i++)
+    graph[i];
+  for(int i = 0; i < 4 * n; i++)
+    graph[dis(eng) % n].push_back(dis(eng) % n);
+
+  iterationRecorder single, multi;
+  auto gr = grank(graph, 10, 20, 50, 0.85, 0.0001, &single);
+  auto grM = grankMulti(graph, 10, 20, 50, 0.85, 0.0001, 4, &multi);
+  ASSERT_EQ(gr.size(), grM.size());
+
+  //same work in every iteration, split among the threads
+  ASSERT_EQ(single.iterations.size(), multi.iterations.size());
+  for(size_t i = 0; i < single.iterations.size(); i++)
+  {
+    ASSERT_EQ(multi.iterations[i].iteration, i);
+    ASSERT_EQ(multi.iterations[i].partition, single.iterations[i].partition);
+    ASSERT_EQ(multi.iterations[i].nodes, single.iterations[i].nodes);
+    ASSERT_EQ(multi.iterations[i].merged, single.iterations[i].merged);
+    ASSERT_EQ(multi.iterations[i].dropped, single.iterations[i].dropped);
+    ASSERT_EQ(multi.iterations[i].allocations, single.iterations[i].allocations);
+    ASSERT_NEAR(multi.iterations[i].maxDiff, single.iterations[i].maxDiff, 10e-9);
+  }
+}
+
+TEST(grankMultiThread, budget)
+{
+  unordered_map<int, vector<int>> graph;
+  int n = 200;
+  for(int i = 0; i < n; i++)
+    graph[i];
+  for(int i = 0; i < 4 * n; i++)
+    graph[dis(eng) % n].push_back(dis(eng) % n);
+
+  //cancelled before the first iteration, same starting maps of grank
+  runBudget cancelled;
+  cancelled.cancel();
+  auto gr = grank(graph, 5, 10, 30, 0.85, -1, nullptr, &cancelled);
+  auto grM = grankMulti(graph, 5, 10, 30, 0.85, -1, 4, nullptr, &cancelled);
+  ASSERT_EQ(gr.size(), grM.size());
+  for(int i = 0; i < n; i++)
+  {
+    ASSERT_EQ(gr[i].size(), grM[i].size());
+    for(const auto& keyVal: gr[i])
+      ASSERT_NEAR(keyVal.second, grM[i][keyVal.first], 10e-9);
+  }
+
+  //a budget which does not expire changes nothing
+  runBudget hour(3600);
+  grM = grankMulti(graph, 5, 10, 30, 0.85, -1, 4, nullptr, &hour);
+  gr = grankMulti(graph, 5, 10, 30, 0.85, -1, 4);
+  ASSERT_FALSE(hour.stoppedEarly());
+  for(int i = 0; i < n; i++)
+    for(const auto& keyVal: gr[i])
+      ASSERT_NEAR(keyVal.second, grM[i][keyVal.first], 10e-9);
+
+  //timeout while running
+  runBudget timeout(0.05);
+  grM = grankMulti(graph, 5, 10, 100000000, 0.85, -1, 4, nullptr, &timeout);
+  ASSERT_TRUE(timeout.stoppedEarly());
+  ASSERT_EQ(grM.size(), n);
+}
@@ -3,6 +3,8 @@
 #include <vector>
 #include <stdlib.h>//exit
 #include <random>
+#include <sstream>
+#include <thread>
 
 #include <gtest.h>
 #include <gtest-spi.h>
@@ -11,6 +13,10 @@
 
 using namespace std;
 using ppr::grank;
+using ppr::grankIteration;
+using ppr::grankJsonLines;
+using ppr::grankObserver;
+using ppr::runBudget;
 using ppr::pprInternal::pprSingleSource;
 
 std::random_device rd;
@@ -377,3 +383,117 @@ TEST(grank, sameAsPagerank4)
       ASSERT_NEAR(gr[i][u], ppr[u], 10e-5);
   }
 }
+
+//keeps the stats of every iteration
+struct iterationRecorder: public grankObserver
+{
+  vector<grankIteration> iterations;
+  void iteration(const grankIteration& stats) { iterations.push_back(stats); }
+};
+
+TEST(grank, observer)
+{
+  //cycle, the two partitions have 50 nodes each
+  unordered_map<int, vector<int>> graph;
+  for(int i = 0; i < 100; i++)
+    graph[i].push_back((i + 1) % 100);
+
+  iterationRecorder recorder;
+  auto observed = grank(graph, 5, 10, 30, 0.85, -1, &recorder);
+  ASSERT_EQ(observed, grank(graph, 5, 10, 30, 0.85, -1));
+  ASSERT_EQ(recorder.iterations.size(), 30);
+  for(size_t i = 0; i < recorder.iterations.size(); i++)
+  {
+    const grankIteration& stats = recorder.iterations[i];
+    ASSERT_EQ(stats.iteration, i);
+    ASSERT_EQ(stats.partition, i % 2);
+    ASSERT_EQ(stats.nodes, 50);
+    ASSERT_GE(stats.merged, 50);
+    ASSERT_GE(stats.allocations, stats.nodes);
+    ASSERT_GE(stats.seconds, stats.combineSeconds);
+  }
+  //maps of the cycle are full (L entries) after a few iterations, then each
+  //node merges the map of its successor and drops its last entry
+  ASSERT_EQ(recorder.iterations.back().merged, 50 * 10);
+  ASSERT_EQ(recorder.iterations.back().dropped, 50);
+  ASSERT_LT(recorder.iterations.back().maxDiff, recorder.iterations.front().maxDiff);
+
+  //with a tolerance the last two iterations (one for each partition) are under it
+  recorder.iterations.clear();
+  grank(graph, 5, 10, 100, 0.85, 0.001, &recorder);
+  ASSERT_LT(recorder.iterations.size(), 100);
+  ASSERT_LT(recorder.iterations.back().maxDiff, 0.001);
+  ASSERT_LT(recorder.iterations[recorder.iterations.size() - 2].maxDiff, 0.001);
+}
+
+TEST(grank, jsonLinesObserver)
+{
+  unordered_map<int, vector<int>> graph;
+  for(int i = 0; i < 10; i++)
+    graph[i].push_back((i + 1) % 10);
+
+  stringstream out;
+  grankJsonLines sink(out);
+  grank(graph, 5, 10, 4, 0.85, -1, &sink);
+  string line;
+  for(size_t i = 0; i < 4; i++)
+  {
+    ASSERT_TRUE(getline(out, line));
+    ASSERT_EQ(line.find("{\"iteration\": " + to_string(i) + ", \"partition\": " + to_string(i % 2)), 0);
+    ASSERT_NE(line.find("\"maxDiff\": "), string::npos);
+    ASSERT_EQ(line.back(), '}');
+  }
+  ASSERT_FALSE(getline(out, line));
+}
+
+TEST(grank, budget)
+{
+  unordered_map<int, vector<int>> graph;
+  for(int i = 0; i < 100; i++)
+    graph[i].push_back((i + 1) % 100);
+
+  //cancelled before the first iteration, the maps are the starting ones
+  runBudget cancelled;
+  cancelled.cancel();
+  auto res = grank(graph, 2, 10, 30, 0.85, -1, nullptr, &cancelled);
+  ASSERT_TRUE(cancelled.stoppedEarly());
+  ASSERT_EQ(res.size(), 100);
+  for(int i = 0; i < 100; i++)
+  {
+    ASSERT_EQ(res[i].size(), 2);
+    ASSERT_NEAR(res[i][i], 0.15, 10e-9);
+    ASSERT_NEAR(res[i][(i + 1) % 100], 0.85, 10e-9);
+  }
+  runBudget expired(0);
+  ASSERT_EQ(grank(graph, 2, 10, 30, 0.85, -1, nullptr, &expired), res);
+
+  //a budget which does not expire changes nothing
+  runBudget hour(3600);
+  ASSERT_EQ(grank(graph, 5, 10, 30, 0.85, -1, nullptr, &hour), grank(graph, 5, 10, 30, 0.85, -1));
+  ASSERT_FALSE(hour.stoppedEarly());
+}
+
+TEST(grank, cancelledWhileRunning)
+{
+  unordered_map<int, vector<int>> graph;
+  int n = 2000;
+  for(int i = 0; i < n; i++)
+    graph[i];
+  for(int i = 0; i < 20 * n; i++)
+    graph[dis(eng) % n].push_back(dis(eng) % n);
+
+  //would take way longer without the cancellation
+  runBudget budget;
+  std::thread canceller([&budget]() { std::this_thread::sleep_for(std::chrono::milliseconds(50)); budget.cancel(); });
+  iterationRecorder recorder;
+  auto res = grank(graph, 10, 100, 1000000, 0.85, -1, &recorder, &budget);
+  canceller.join();
+  ASSERT_TRUE(budget.stoppedEarly());
+  ASSERT_LT(recorder.iterations.size(), 1000000);
+  ASSERT_EQ(res.size(), n);
+  for(const auto& keyVal: res)
+  {
+    ASSERT_GT(keyVal.second.size(), 0);
+    ASSERT_LE(keyVal.second.size(), 10);
+  }
+}
@@ -0,0 +1,119 @@
+#include <unordered_map>
+#include <vector>
+#include <stdlib.h>//exit
+#include <random>
+
+#include <gtest.h>
+#include <gtest-spi.h>
+#include <graphGenerators.h>
+
+using namespace std;
+using ppr::barabasiAlbertGraph;
+using ppr::dagGraph;
+using ppr::erdosRenyiGraph;
+using ppr::gridGraph;
+using ppr::rmatGraph;
+
+extern random_device rd;
+extern default_random_engine eng;
+extern uniform_int_distribution<unsigned long long> dis;
+
+static size_t countEdges(const unordered_map<int, vector<int>>& graph)
+{
+  size_t edges = 0;
+  for(const auto& keyVal: graph)
+    edges += keyVal.second.size();
+  return edges;
+}
+
+TEST(graphGenerators, badParameters)
+{
+  ASSERT_EXIT(rmatGraph<int>(4, 10, 0.6, 0.3, 0.3, 1, 1), ::testing::ExitedWithCode(EXIT_FAILURE),
+    "a, b, c must be probabilities with a sum <= 1");
+  ASSERT_EXIT(rmatGraph<int>(4, 10, 0.57, 0.19, 0.19, 1, 0), ::testing::ExitedWithCode(EXIT_FAILURE), "nThreads must be positive");
+  ASSERT_EXIT(erdosRenyiGraph<int>(10, 11, 1, 1), ::testing::ExitedWithCode(EXIT_FAILURE), "averageDegree must be \\[0,n]");
+  ASSERT_EXIT(barabasiAlbertGraph<int>(10, 0, 1, 1), ::testing::ExitedWithCode(EXIT_FAILURE), "edgesPerNode must be positive");
+  ASSERT_EXIT(dagGraph<int>(10, 2, 1, 0), ::testing::ExitedWithCode(EXIT_FAILURE), "nThreads must be positive");
+}
+
+TEST(graphGenerators, sameSeedSameGraph)
+{
+  //more than one task, so that threads matter
+  uint64_t seed = dis(eng);
+  auto rmat = rmatGraph<int>(14, 50000, 0.57, 0.19, 0.19, seed, 1);
+  ASSERT_EQ(rmat, rmatGraph<int>(14, 50000, 0.57, 0.19, 0.19, seed, 4));
+  ASSERT_NE(rmat, rmatGraph<int>(14, 50000, 0.57, 0.19, 0.19, seed + 1, 4));
+  auto er = erdosRenyiGraph<int>(40000, 3, seed, 1);
+  ASSERT_EQ(er, erdosRenyiGraph<int>(40000, 3, seed, 3));
+  auto ba = barabasiAlbertGraph<int>(40000, 3, seed, 1);
+  ASSERT_EQ(ba, barabasiAlbertGraph<int>(40000, 3, seed, 3));
+  auto dag = dagGraph<int>(40000, 3, seed, 1);
+  ASSERT_EQ(dag, dagGraph<int>(40000, 3, seed, 3));
+}
+
+TEST(graphGenerators, rmat)
+{
+  auto graph = rmatGraph<int>(10, 20000, 0.57, 0.19, 0.19, dis(eng), 2);
+  ASSERT_EQ(graph.size(), 1024);
+  ASSERT_EQ(countEdges(graph), 20000);
+  //skewed: node 0 is in the top left corner at every level
+  size_t maxDegree = 0;
+  for(const auto& keyVal: graph)
+    maxDegree = max(maxDegree, keyVal.second.size());
+  ASSERT_GT(maxDegree, 10 * 20000 / 1024);
+}
+
+TEST(graphGenerators, erdosRenyi)
+{
+  auto graph = erdosRenyiGraph<int>(20000, 5, dis(eng), 2);
+  ASSERT_EQ(graph.size(), 20000);
+  ASSERT_NEAR(countEdges(graph) / 20000.0, 5, 0.1);
+  for(const auto& keyVal: graph)
+    for(size_t i = 1; i < keyVal.second.size(); i++)
+      ASSERT_LT(keyVal.second[i - 1], keyVal.second[i]);
+
+  ASSERT_EQ(countEdges(erdosRenyiGraph<int>(100, 0, 1, 1)), 0);
+  ASSERT_EQ(countEdges(erdosRenyiGraph<int>(100, 100, 1, 1)), 100 * 100);
+}
+
+TEST(graphGenerators, barabasiAlbert)
+{
+  auto graph = barabasiAlbertGraph<int>(20000, 4, dis(eng), 2);
+  ASSERT_EQ(graph.size(), 20000);
+  unordered_map<int, size_t> indegree;
+  for(const auto& keyVal: graph)
+  {
+    ASSERT_EQ(keyVal.second.size(), 4);
+    for(int v: keyVal.second)
+    {
+      ASSERT_LE(v, keyVal.first);
+      indegree[v]++;
+    }
+  }
+  //preferential attachment gives hubs, far above the average indegree of 4
+  size_t maxIndegree = 0;
+  for(const auto& keyVal: indegree)
+    maxIndegree = max(maxIndegree, keyVal.second);
+  ASSERT_GT(maxIndegree, 100);
+}
+
+TEST(graphGenerators, grid)
+{
+  auto graph = gridGraph<int>(3, 4);
+  ASSERT_EQ(graph.size(), 12);
+  ASSERT_EQ(countEdges(graph), 2 * (3 * 3 + 2 * 4));
+  ASSERT_EQ(graph[0], vector<int>({4, 1}));
+  ASSERT_EQ(graph[5], vector<int>({1, 9, 4, 6}));
+}
+
+TEST(graphGenerators, dag)
+{
+  auto graph = dagGraph<int>(1000, 5, dis(eng), 2);
+  ASSERT_EQ(graph.size(), 1000);
+  for(const auto& keyVal: graph)
+  {
+    ASSERT_EQ(keyVal.second.size(), min<size_t>(5, 1000 - keyVal.first - 1));
+    for(int v: keyVal.second)
+      ASSERT_GT(v, keyVal.first);
+  }
+}
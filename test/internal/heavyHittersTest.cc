@@ -0,0 +1,125 @@
+#include <algorithm>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include <gtest.h>
+#include <gtest-spi.h>
+#include <heavyHitters.h>
+
+using namespace std;
+using ppr::pprInternal::noSlot;
+using ppr::pprInternal::spaceSaving;
+
+extern random_device rd;
+extern default_random_engine eng;
+extern uniform_int_distribution<unsigned long long> dis;
+
+TEST(heavyHitters, exactUnderCapacity)
+{
+  vector<size_t> slots(100, noSlot);
+  spaceSaving counter(10, slots);
+  unordered_map<size_t, double> truth;
+  for(int i = 0; i < 1000; i++)
+  {
+    size_t id = dis(eng) % 10;
+    counter.increment(id);
+    truth[id]++;
+  }
+
+  auto entries = counter.entries();
+  ASSERT_EQ(entries.size(), truth.size());
+  for(const auto& entry: entries)
+  {
+    ASSERT_EQ(entry.second, truth[entry.first]);
+    ASSERT_EQ(counter.error(entry.first), 0);
+  }
+}
+
+TEST(heavyHitters, heavyNodesSurvive)
+{
+  //3 ids taking most of the stream, seen late, and many rare ids
+  vector<size_t> slots(10000, noSlot);
+  spaceSaving counter(8, slots);
+  unordered_map<size_t, double> truth;
+  vector<size_t> stream;
+  for(size_t id = 10; id < 5000; id++)
+    stream.push_back(id);
+  for(int i = 0; i < 3000; i++)
+    stream.push_back(i % 3);
+  shuffle(stream.begin() + 1000, stream.end(), eng);
+  for(size_t id: stream)
+  {
+    counter.increment(id);
+    truth[id]++;
+  }
+
+  ASSERT_EQ(counter.size(), 8);
+  unordered_map<size_t, double> estimates;
+  for(const auto& entry: counter.entries())
+    estimates[entry.first] = entry.second;
+  for(size_t id = 0; id < 3; id++)
+  {
+    ASSERT_TRUE(estimates.find(id) != estimates.end());
+    //estimates are upper bounds, off by at most the error
+    ASSERT_GE(estimates[id], truth[id]);
+    ASSERT_LE(estimates[id] - counter.error(id), truth[id]);
+  }
+
+  //the sum of the estimates is the length of the stream
+  double sum = 0;
+  for(const auto& keyVal: estimates)
+    sum += keyVal.second;
+  ASSERT_EQ(sum, stream.size());
+}
+
+TEST(heavyHitters, errorBound)
+{
+  //every error is at most N / capacity
+  vector<size_t> slots(1000, noSlot);
+  spaceSaving counter(20, slots);
+  unordered_map<size_t, double> truth;
+  size_t N = 20000;
+  for(size_t i = 0; i < N; i++)
+  {
+    //skewed stream
+    size_t id = (dis(eng) % 1000) * (dis(eng) % 1000) / 1000;
+    counter.increment(id);
+    truth[id]++;
+  }
+  for(const auto& entry: counter.entries())
+  {
+    ASSERT_GE(entry.second, truth[entry.first]);
+    ASSERT_LE(counter.error(entry.first), N / 20);
+  }
+}
+
+TEST(heavyHitters, clearResetsSlots)
+{
+  vector<size_t> slots(50, noSlot);
+  {
+    spaceSaving counter(5, slots);
+    for(size_t id = 0; id < 50; id++)
+      counter.increment(id);
+    counter.clear();
+    ASSERT_EQ(counter.size(), 0);
+    ASSERT_EQ(count(slots.begin(), slots.end(), noSlot), 50);
+
+    counter.increment(3);
+    counter.increment(3);
+    ASSERT_EQ(counter.entries().size(), 1);
+    ASSERT_EQ(counter.entries()[0].second, 2);
+  }
+  //the destructor clears too
+  ASSERT_EQ(count(slots.begin(), slots.end(), noSlot), 50);
+}
+
+TEST(heavyHitters, zeroCapacity)
+{
+  vector<size_t> slots(10, noSlot);
+  spaceSaving counter(0, slots);
+  for(size_t id = 0; id < 10; id++)
+    counter.increment(id);
+  ASSERT_EQ(counter.size(), 0);
+  ASSERT_TRUE(counter.entries().empty());
+}
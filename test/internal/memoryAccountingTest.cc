@@ -0,0 +1,146 @@
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <gtest.h>
+#include <gtest-spi.h>
+#include <grank.h>
+#include <graphGenerators.h>
+#include <mccompletepathv2.h>
+#include <memoryAccounting.h>
+
+//the whole test binary is accounted
+PPR_MEMORY_ACCOUNTING
+
+using namespace std;
+using namespace ppr;
+
+namespace
+{
+  const memoryPhaseReport& lastPhase(const string& name)
+  {
+    static vector<memoryPhaseReport> phases;
+    phases = memoryPhases();
+    for(size_t i = phases.size(); i > 0; i--)
+      if(phases[i - 1].name == name)
+        return phases[i - 1];
+    static memoryPhaseReport none;
+    return none;
+  }
+
+  //true if the measured peak is within a factor of the estimate
+  bool closeTo(size_t measured, size_t estimate, double factor)
+  {
+    return measured <= estimate * factor && estimate <= measured * factor;
+  }
+}
+
+TEST(memoryAccounting, scopes)
+{
+  ASSERT_TRUE(memoryAccountingEnabled());
+  size_t graph = liveMemory(memoryGraph);
+  size_t scratch = liveMemory(memoryScratch);
+  {
+    memoryScope scope(memoryGraph);
+    vector<char>* block = new vector<char>(1000);
+    ASSERT_GE(liveMemory(memoryGraph), graph + 1000);
+    {
+      memoryScope inner(memoryScratch);
+      //freed on the category it was allocated to
+      delete block;
+      ASSERT_EQ(liveMemory(memoryGraph), graph);
+      block = new vector<char>(500);
+      ASSERT_GE(liveMemory(memoryScratch), scratch + 500);
+    }
+    vector<char> other(100);
+    ASSERT_GE(liveMemory(memoryGraph), graph + 100);
+    scope.set(memoryScores);
+    delete block;
+  }
+  ASSERT_EQ(liveMemory(memoryGraph), graph);
+  ASSERT_EQ(liveMemory(memoryScratch), scratch);
+
+  //freed blocks still count as allocated
+  size_t allocated = allocatedMemory();
+  delete new vector<char>(300);
+  ASSERT_EQ(allocatedMemory(), allocated + sizeof(vector<char>) + 300);
+}
+
+TEST(memoryAccounting, phases)
+{
+  clearMemoryPhases();
+  size_t scratch = liveMemory(memoryScratch);
+  {
+    memoryPhase outer("outer");
+    memoryScope scope(memoryScratch);
+    {
+      memoryPhase inner("inner");
+      vector<char> block(10000);
+    }
+    vector<char> block(2000);
+    outer.end();
+    //ended once
+    outer.end();
+  }
+  vector<memoryPhaseReport> phases = memoryPhases();
+  ASSERT_EQ(phases.size(), 2u);
+  ASSERT_EQ(phases[0].name, "inner");
+  ASSERT_EQ(phases[1].name, "outer");
+  ASSERT_EQ(phases[0].peak[memoryScratch], scratch + 10000);
+  //the peak of the inner phase is part of the outer one
+  ASSERT_EQ(phases[1].peak[memoryScratch], scratch + 10000);
+  ASSERT_GE(phases[1].peakTotal, phases[1].peak[memoryScratch]);
+
+  {
+    memoryPhase later("later");
+    memoryScope scope(memoryScratch);
+    vector<char> block(2000);
+  }
+  ASSERT_EQ(lastPhase("later").peak[memoryScratch], scratch + 2000);
+  clearMemoryPhases();
+  ASSERT_TRUE(memoryPhases().empty());
+}
+
+TEST(memoryAccounting, grankEstimate)
+{
+  for(size_t L: {5, 20})
+  {
+    unordered_map<unsigned long long, vector<unsigned long long>> graph;
+    {
+      memoryScope scope(memoryGraph);
+      graph = erdosRenyiGraph<unsigned long long>(2000, 8, L, 1);
+    }
+    size_t edges = 0;
+    for(const auto& keyVal: graph)
+      edges += keyVal.second.size();
+
+    memoryEstimate estimate = grankMemoryEstimate<unsigned long long>(graph.size(), edges, L);
+    grank(graph, L, L, 10, 0.85, -1);
+    const memoryPhaseReport& phase = lastPhase("grank");
+    ASSERT_TRUE(closeTo(phase.peak[memoryGraph], estimate.graph, 1.5));
+    ASSERT_TRUE(closeTo(phase.peak[memoryScores], estimate.scores, 2));
+    ASSERT_TRUE(closeTo(phase.peakTotal, estimate.total, 2));
+  }
+}
+
+TEST(memoryAccounting, mccompletepathv2Estimate)
+{
+  for(size_t L: {5, 20})
+  {
+    unordered_map<unsigned long long, vector<unsigned long long>> graph;
+    {
+      memoryScope scope(memoryGraph);
+      graph = erdosRenyiGraph<unsigned long long>(2000, 8, L, 1);
+    }
+    size_t edges = 0;
+    for(const auto& keyVal: graph)
+      edges += keyVal.second.size();
+
+    memoryEstimate estimate = mccompletepathv2MemoryEstimate<unsigned long long>(graph.size(), edges, L);
+    mccompletepathv2(graph, L, L, 100, 0.85, 1);
+    const memoryPhaseReport& phase = lastPhase("mccompletepathv2");
+    ASSERT_TRUE(closeTo(phase.peak[memoryGraph], estimate.graph, 1.5));
+    ASSERT_TRUE(closeTo(phase.peak[memoryScores], estimate.scores, 2));
+    ASSERT_TRUE(closeTo(phase.peakTotal, estimate.total, 2));
+  }
+}
@@ -0,0 +1,38 @@
+#include <cstdio>//remove
+#include <unordered_map>
+#include <vector>
+
+#include <gtest.h>
+#include <gtest-spi.h>
+#include <pagerankCache.h>
+
+using namespace std;
+using ppr::pprInternal::pagerankCache;
+
+TEST(pagerankCache, saveAndLoad)
+{
+  pagerankCache cache;
+  cache.graph = 42; cache.n = 10; cache.iterations = 100; cache.damping = 0.85; cache.tolerance = 0.0001;
+  cache.topN = 3;
+  cache.scores[0] = {{0, 0.5}, {3, 0.25}, {9, 0.125}};
+  cache.scores[7];
+  const char* path = "pagerankCacheTest.bin";
+  ASSERT_TRUE(cache.save(path));
+
+  pagerankCache loaded;
+  ASSERT_TRUE(loaded.load(path, 42, 10, 100, 0.85, 0.0001, 3));
+  ASSERT_EQ(loaded.scores, cache.scores);
+  ASSERT_EQ(loaded.topN, 3);
+
+  //different graph or parameters
+  pagerankCache other;
+  ASSERT_FALSE(other.load(path, 43, 10, 100, 0.85, 0.0001, 3));
+  ASSERT_FALSE(other.load(path, 42, 11, 100, 0.85, 0.0001, 3));
+  ASSERT_FALSE(other.load(path, 42, 10, 99, 0.85, 0.0001, 3));
+  ASSERT_FALSE(other.load(path, 42, 10, 100, 0.8, 0.0001, 3));
+  ASSERT_FALSE(other.load(path, 42, 10, 100, 0.85, 0.001, 3));
+  ASSERT_FALSE(other.load(path, 42, 10, 100, 0.85, 0.0001, 0));
+  ASSERT_TRUE(other.scores.empty());
+  remove(path);
+  ASSERT_FALSE(other.load(path, 42, 10, 100, 0.85, 0.0001, 3));
+}
@@ -0,0 +1,131 @@
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include <gtest.h>
+#include <gtest-spi.h>
+#include <pprGraph.h>
+
+using namespace std;
+using ppr::pprInternal::adjacency;
+using ppr::pprInternal::makeDenseGraph;
+using ppr::pprInternal::stronglyConnectedComponents;
+using ppr::pprInternal::transpose;
+
+extern random_device rd;
+extern default_random_engine eng;
+extern uniform_int_distribution<unsigned long long> dis;
+
+TEST(pprGraph, denseGraph)
+{
+  unordered_map<int, vector<int>> graph;
+  graph[0] = {1, 2, 1};
+  graph[1] = {2};
+  graph[2];
+  auto dense = makeDenseGraph(graph);
+
+  ASSERT_EQ(dense.size(), 3);
+  for(int i = 0; i < 3; i++)
+  {
+    size_t id = dense.ids[i];
+    ASSERT_EQ(dense.keys[id], i);
+    ASSERT_EQ(dense.successors.degree(id), graph[i].size());
+    for(size_t j = 0; j < graph[i].size(); j++)
+      ASSERT_EQ(dense.keys[dense.successors.begin(id)[j]], graph[i][j]);
+  }
+
+  adjacency predecessors = transpose(dense.successors);
+  ASSERT_EQ(predecessors.degree(dense.ids[0]), 0);
+  ASSERT_EQ(predecessors.degree(dense.ids[1]), 2);
+  ASSERT_EQ(predecessors.degree(dense.ids[2]), 2);
+}
+
+TEST(pprGraph, componentsOfCycles)
+{
+  //two cycles {0, 1, 2} -> {3, 4}, plus 5 alone with a self loop and 6 alone
+  unordered_map<int, vector<int>> graph;
+  graph[0] = {1};
+  graph[1] = {2};
+  graph[2] = {0, 3};
+  graph[3] = {4};
+  graph[4] = {3};
+  graph[5] = {5, 0};
+  graph[6];
+  auto dense = makeDenseGraph(graph);
+  vector<size_t> component;
+  ASSERT_EQ(stronglyConnectedComponents(dense.successors, component), 4);
+
+  auto c = [&](int node) { return component[dense.ids[node]]; };
+  ASSERT_EQ(c(0), c(1));
+  ASSERT_EQ(c(0), c(2));
+  ASSERT_EQ(c(3), c(4));
+  ASSERT_NE(c(0), c(3));
+  ASSERT_NE(c(5), c(0));
+  ASSERT_NE(c(6), c(0));
+  //successors come first
+  ASSERT_LT(c(3), c(0));
+  ASSERT_LT(c(0), c(5));
+}
+
+TEST(pprGraph, componentsAreReverseTopological)
+{
+  unordered_map<int, vector<int>> graph;
+  for(int i = 0; i < 300; i++)
+    graph[i];
+  for(int i = 0; i < 600; i++)
+    graph[dis(eng) % 300].push_back(dis(eng) % 300);
+  auto dense = makeDenseGraph(graph);
+  vector<size_t> component;
+  size_t count = stronglyConnectedComponents(dense.successors, component);
+
+  //every edge goes to the same component or to a lower one, and nodes
+  //of the same component reach each other
+  for(size_t u = 0; u < dense.size(); u++)
+  {
+    ASSERT_LT(component[u], count);
+    for(const size_t* it = dense.successors.begin(u); it != dense.successors.end(u); it++)
+      ASSERT_LE(component[*it], component[u]);
+  }
+  adjacency predecessors = transpose(dense.successors);
+  for(size_t root = 0; root < dense.size(); root += 37)
+  {
+    //nodes reaching and reached by root
+    vector<bool> forward(dense.size(), false), backward(dense.size(), false);
+    for(int dir = 0; dir < 2; dir++)
+    {
+      const adjacency& a = dir? predecessors : dense.successors;
+      vector<bool>& seen = dir? backward : forward;
+      vector<size_t> stack = {root};
+      seen[root] = true;
+      while(!stack.empty())
+      {
+        size_t u = stack.back(); stack.pop_back();
+        for(const size_t* it = a.begin(u); it != a.end(u); it++)
+          if(!seen[*it])
+          {
+            seen[*it] = true;
+            stack.push_back(*it);
+          }
+      }
+    }
+    for(size_t u = 0; u < dense.size(); u++)
+      ASSERT_EQ(component[u] == component[root], forward[u] && backward[u]);
+  }
+}
+
+TEST(pprGraph, componentsOfDeepGraph)
+{
+  //a path of a million nodes, closed into a single cycle
+  const int n = 1000000;
+  unordered_map<int, vector<int>> graph;
+  for(int i = 0; i < n; i++)
+    graph[i].push_back(i + 1);
+  graph[n];
+  auto dense = makeDenseGraph(graph);
+  vector<size_t> component;
+  ASSERT_EQ(stronglyConnectedComponents(dense.successors, component), n + 1);
+
+  graph[n].push_back(0);
+  dense = makeDenseGraph(graph);
+  ASSERT_EQ(stronglyConnectedComponents(dense.successors, component), 1);
+}
@@ -0,0 +1,93 @@
+#include <unordered_set>
+#include <vector>
+
+#include <gtest.h>
+#include <gtest-spi.h>
+#include <pprRandom.h>
+
+using namespace std;
+using ppr::pprInternal::deriveSeed;
+using ppr::pprInternal::xoshiro256;
+
+TEST(pprRandom, referenceValues)
+{
+  //values from the reference implementation of xoshiro256** seeded with splitmix64(42)
+  xoshiro256 generator(42);
+  ASSERT_EQ(generator(), 1546998764402558742ULL);
+  ASSERT_EQ(generator(), 6990951692964543102ULL);
+  ASSERT_EQ(generator(), 12544586762248559009ULL);
+}
+
+TEST(pprRandom, sameSeedSameSequence)
+{
+  xoshiro256 g1(7);
+  xoshiro256 g2(7);
+  xoshiro256 g3(8);
+  bool different = false;
+  for(int i = 0; i < 1000; i++)
+  {
+    uint64_t v = g1();
+    ASSERT_EQ(v, g2());
+    different = different || v != g3();
+  }
+  ASSERT_TRUE(different);
+
+  g1.reseed(7);
+  g2.reseed(7);
+  for(int i = 0; i < 10; i++)
+    ASSERT_EQ(g1(), g2());
+}
+
+TEST(pprRandom, nextDouble)
+{
+  xoshiro256 generator(3);
+  double sum = 0;
+  const int n = 100000;
+  for(int i = 0; i < n; i++)
+  {
+    double v = generator.nextDouble();
+    ASSERT_GE(v, 0.0);
+    ASSERT_LT(v, 1.0);
+    sum += v;
+  }
+  ASSERT_NEAR(sum / n, 0.5, 0.01);
+}
+
+TEST(pprRandom, deriveSeed)
+{
+  unordered_set<uint64_t> seeds;
+  for(uint64_t i = 0; i < 1000; i++)
+  {
+    ASSERT_EQ(deriveSeed(1, i), deriveSeed(1, i));
+    seeds.insert(deriveSeed(1, i));
+    seeds.insert(deriveSeed(2, i));
+  }
+  ASSERT_EQ(seeds.size(), 2000);
+}
+
+TEST(pprRandom, walkLength)
+{
+  xoshiro256 generator(5);
+  ppr::pprInternal::walkLength lengths(generator, 0.85);
+  const int n = 200000;
+  double sum = 0;
+  int ones = 0;
+  for(int i = 0; i < n; i++)
+  {
+    size_t length = lengths();
+    ASSERT_GE(length, 1);
+    sum += length;
+    ones += length == 1;
+  }
+  //1 + geometric, mean 1 / (1 - damping), P(1) = 1 - damping
+  ASSERT_NEAR(sum / n, 1.0 / 0.15, 0.05);
+  ASSERT_NEAR(static_cast<double>(ones) / n, 0.15, 0.005);
+
+  ppr::pprInternal::walkLength noDamping(generator, 0);
+  ppr::pprInternal::walkLength fullDamping(generator, 1);
+  for(int i = 0; i < 100; i++)
+  {
+    ASSERT_EQ(noDamping(), 1);
+    ASSERT_EQ(fullDamping(), SIZE_MAX);
+  }
+}
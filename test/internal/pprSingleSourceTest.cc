@@ -2,14 +2,46 @@
 #include <unordered_map>
 #include <vector>
 #include <stdlib.h>//exit
+#include <random>
 
 #include <gtest.h>
 #include <gtest-spi.h>
 #include <pprSingleSource.h>
 
 using namespace std;
+using ppr::pprInternal::makeDenseGraph;
+using ppr::pprInternal::norm1;
+using ppr::pprInternal::pprMultiSource;
 using ppr::pprInternal::pprSingleSource;
 
+extern random_device rd;
+extern default_random_engine eng;
+extern uniform_int_distribution<unsigned long long> dis;
+
+//power iteration with the scores always in a map
+static unordered_map<int, double> referencePagerank(const unordered_map<int, vector<int>>& graph,
+  size_t iterations, double damping, double tolerance, int source)
+{
+  unordered_map<int, double> scores;
+  unordered_map<int, double> nextScores;
+  scores[source] = 1.0;
+  double diff = tolerance;
+  for(size_t i = 0; i < iterations && diff >= tolerance; i++)
+  {
+    nextScores.clear();
+    nextScores[source] = 1.0 - damping;
+    for(const auto& keyVal: scores)
+    {
+      const vector<int>& successors = graph.find(keyVal.first)->second;
+      for(int successor: successors)
+        nextScores[successor] += keyVal.second * damping / successors.size();
+    }
+    diff = norm1(scores, nextScores);
+    scores.swap(nextScores);
+  }
+  return scores;
+}
+
 TEST(pprSingleSource, badParameters)
 {
   unordered_map<int, vector<int>> graph;
@@ -191,3 +223,90 @@ TEST(pprSingleSource, testCorrectlyOrderedScore3)
     ASSERT_TRUE(res[5] > res[i]);
   }
 }
+
+TEST(pprSingleSource, denseBadParameters)
+{
+  unordered_map<int, vector<int>> graph;
+  graph[0];
+  auto dense = makeDenseGraph(graph);
+  ASSERT_EXIT(pprSingleSource(dense, 0, 0.85, 0.001, 0), ::testing::ExitedWithCode(EXIT_FAILURE), "iterations must be positive");
+  ASSERT_EXIT(pprSingleSource(dense, 1, 1.85, 0.001, 0), ::testing::ExitedWithCode(EXIT_FAILURE), "damping must be \\[0,1]");
+  ASSERT_EXIT(pprSingleSource(dense, 1, 0.85, 0.001, 1), ::testing::ExitedWithCode(EXIT_FAILURE), "source node not part of the graph");
+}
+
+TEST(pprSingleSource, sameAsSparse)
+{
+  //sparse graphs where the scores stay in the map and dense ones where they
+  //move to vectors, with and without tolerance
+  for(int maxEdges: {1, 2, 4, 16})
+  {
+    unordered_map<int, vector<int>> graph;
+    for(int i = 0; i < 500; i++)
+    {
+      graph[i];
+      for(int e = 0, edges = dis(eng) % maxEdges; e < edges; e++)
+        graph[i].push_back(dis(eng) % 500);
+    }
+    auto dense = makeDenseGraph(graph);
+
+    for(int source = 0; source < 500; source += 41)
+      for(double tolerance: {0.0001, -1.0})
+      {
+        auto expected = referencePagerank(graph, 30, 0.85, tolerance, source);
+        auto res = pprSingleSource(graph, 30, 0.85, tolerance, source);
+        auto resDense = pprSingleSource(dense, 30, 0.85, tolerance, dense.ids.find(source)->second);
+        ASSERT_EQ(res.size(), expected.size());
+        ASSERT_EQ(resDense.size(), expected.size());
+        for(const auto& keyVal: expected)
+        {
+          ASSERT_NEAR(res[keyVal.first], keyVal.second, 1e-12);
+          ASSERT_NEAR(resDense[keyVal.first], keyVal.second, 1e-12);
+        }
+      }
+  }
+}
+
+TEST(pprMultiSource, badParameters)
+{
+  unordered_map<int, vector<int>> graph;
+  graph[0];
+  auto dense = makeDenseGraph(graph);
+  ASSERT_EXIT(pprMultiSource(dense, {0}, 0, 0.85, 0.001), ::testing::ExitedWithCode(EXIT_FAILURE), "iterations must be positive");
+  ASSERT_EXIT(pprMultiSource(dense, {0}, 1, -0.85, 0.001), ::testing::ExitedWithCode(EXIT_FAILURE), "damping must be \\[0,1]");
+  ASSERT_EXIT(pprMultiSource(dense, {0, 1}, 1, 0.85, 0.001), ::testing::ExitedWithCode(EXIT_FAILURE), "source node not part of the graph");
+  ASSERT_EQ(pprMultiSource(dense, {}, 1, 0.85, 0.001).size(), 0);
+}
+
+TEST(pprMultiSource, sameAsSingleSource)
+{
+  for(int maxEdges: {1, 3, 8})
+  {
+    unordered_map<int, vector<int>> graph;
+    for(int i = 0; i < 300; i++)
+    {
+      graph[i];
+      for(int e = 0, edges = dis(eng) % maxEdges; e < edges; e++)
+        graph[i].push_back(dis(eng) % 300);
+    }
+    auto dense = makeDenseGraph(graph);
+
+    //more sources than a batch, with repetitions
+    vector<size_t> sources;
+    for(int i = 0; i < 21; i++)
+      sources.push_back(dis(eng) % 300);
+    sources.push_back(sources[0]);
+
+    for(double tolerance: {0.0001, -1.0})
+    {
+      auto res = pprMultiSource(dense, sources, 30, 0.85, tolerance);
+      ASSERT_EQ(res.size(), sources.size());
+      for(size_t i = 0; i < sources.size(); i++)
+      {
+        auto expected = referencePagerank(graph, 30, 0.85, tolerance, dense.keys[sources[i]]);
+        ASSERT_EQ(res[i].size(), expected.size());
+        for(const auto& keyVal: expected)
+          ASSERT_NEAR(res[i][keyVal.first], keyVal.second, 1e-12);
+      }
+    }
+  }
+}
@@ -0,0 +1,215 @@
+#include <cstdio>//remove
+#include <fstream>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include <gtest.h>
+#include <gtest-spi.h>
+#include <walkSegments.h>
+
+using namespace std;
+using ppr::pprInternal::buildSegments;
+using ppr::pprInternal::fingerprint;
+using ppr::pprInternal::makeDenseGraph;
+using ppr::pprInternal::segmentEnd;
+using ppr::pprInternal::segmentReader;
+using ppr::pprInternal::walkSegments;
+
+extern random_device rd;
+extern default_random_engine eng;
+extern uniform_int_distribution<unsigned long long> dis;
+
+TEST(walkSegments, segmentsArePaths)
+{
+  unordered_map<int, vector<int>> graph;
+  for(int i = 0; i < 100; i++)
+    graph[i];
+  for(int i = 0; i < 300; i++)
+    graph[dis(eng)%100].push_back(dis(eng)%100);
+  auto dense = makeDenseGraph(graph);
+  walkSegments segments = buildSegments(dense, 5, 3, 0, 1);
+
+  for(size_t u = 0; u < dense.size(); u++)
+  {
+    ASSERT_EQ(segments.count(u), dense.successors.degree(u) > 0? 3 : 0);
+    for(size_t i = 0; i < segments.count(u); i++)
+    {
+      const size_t* segment = segments.segment(u, i);
+      size_t previous = u;
+      for(size_t step = 0; step < 5; step++)
+      {
+        if(segment[step] == segmentEnd)
+        {
+          //stopped at a node without successors
+          ASSERT_EQ(dense.successors.degree(previous), 0);
+          for(; step < 5; step++)
+            ASSERT_EQ(segment[step], segmentEnd);
+          break;
+        }
+        const size_t* begin = dense.successors.begin(previous);
+        const size_t* end = dense.successors.end(previous);
+        ASSERT_TRUE(find(begin, end, segment[step]) != end);
+        previous = segment[step];
+      }
+    }
+  }
+}
+
+TEST(walkSegments, memoryCap)
+{
+  //node 0 has the highest in-degree, then 1, then 2
+  unordered_map<int, vector<int>> graph;
+  for(int i = 0; i < 50; i++)
+  {
+    graph[i] = {0, 1, 2};
+    if(i < 20)
+      graph[i].push_back(0);
+    if(i < 10)
+      graph[i].push_back(1);
+  }
+  graph[0].push_back(3);
+  graph[1].push_back(3);
+  auto dense = makeDenseGraph(graph);
+
+  //the offsets and the counters of the reader, plus room for 7 segments of
+  //4 edges: 2 nodes with 3 segments each
+  size_t fixed = (2 * dense.size() + 1) * sizeof(size_t);
+  size_t cap = fixed + 7 * 4 * sizeof(size_t);
+  walkSegments segments = buildSegments(dense, 4, 3, cap, 1);
+  ASSERT_LE((segments.offsets.size() + segments.nodes.size() + dense.size()) * sizeof(size_t), cap);
+  ASSERT_EQ(segments.count(dense.ids[0]), 3);
+  ASSERT_EQ(segments.count(dense.ids[1]), 3);
+  ASSERT_EQ(segments.count(dense.ids[2]), 0);
+  ASSERT_EQ(segments.offsets.back(), 6);
+
+  //no room for any segment
+  segments = buildSegments(dense, 4, 3, fixed, 1);
+  ASSERT_TRUE(segments.nodes.empty());
+  ASSERT_EQ(segments.offsets.back(), 0);
+}
+
+TEST(walkSegments, saveAndLoad)
+{
+  unordered_map<int, vector<int>> graph;
+  for(int i = 0; i < 100; i++)
+    graph[i].push_back((i + 1) % 100);
+  for(int i = 0; i < 200; i++)
+    graph[dis(eng)%100].push_back(dis(eng)%100);
+  auto dense = makeDenseGraph(graph);
+  walkSegments segments = buildSegments(dense, 6, 2, 0, 3);
+  const char* path = "walkSegmentsTest.bin";
+  ASSERT_TRUE(segments.save(path));
+
+  walkSegments loaded;
+  ASSERT_TRUE(loaded.load(path, fingerprint(dense), dense.size(), 6, 2, 0));
+  ASSERT_EQ(loaded.graph, segments.graph);
+  ASSERT_EQ(loaded.offsets, segments.offsets);
+  ASSERT_EQ(loaded.nodes, segments.nodes);
+
+  //different graph or parameters
+  walkSegments other;
+  ASSERT_FALSE(other.load(path, fingerprint(dense) + 1, dense.size(), 6, 2, 0));
+  ASSERT_FALSE(other.load(path, fingerprint(dense), dense.size(), 5, 2, 0));
+  ASSERT_FALSE(other.load(path, fingerprint(dense), dense.size(), 6, 3, 0));
+  ASSERT_FALSE(other.load(path, fingerprint(dense), dense.size(), 6, 2, 1024));
+  ASSERT_TRUE(other.nodes.empty());
+  remove(path);
+  ASSERT_FALSE(other.load(path, fingerprint(dense), dense.size(), 6, 2, 0));
+
+  //an edge more changes the fingerprint
+  graph[0].push_back(5);
+  ASSERT_NE(fingerprint(makeDenseGraph(graph)), fingerprint(dense));
+}
+
+//overwrite a word of a file of segments
+static void patchWord(const char* path, size_t word, uint64_t value)
+{
+  fstream file(path, ios::in | ios::out | ios::binary);
+  file.seekp(word * sizeof(uint64_t));
+  file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+TEST(walkSegments, corruptFile)
+{
+  unordered_map<int, vector<int>> graph;
+  for(int i = 0; i < 50; i++)
+    graph[i] = {(i + 1) % 50, (i + 7) % 50};
+  graph[50];
+  graph[0].push_back(50);
+  auto dense = makeDenseGraph(graph);
+  size_t n = dense.size();
+  walkSegments segments = buildSegments(dense, 4, 2, 0, 1);
+  const char* path = "walkSegmentsCorruptTest.bin";
+  //header, offsets, nodes
+  size_t offsetsAt = 7;
+  size_t nodesAt = offsetsAt + n + 1;
+
+  auto loads = [&]()
+  {
+    walkSegments loaded;
+    return loaded.load(path, fingerprint(dense), n, 4, 2, 0);
+  };
+  //a segment which does not stop at a dead end
+  size_t full = 0;
+  while(segments.nodes[full * 4 + 3] == segmentEnd)
+    full++;
+
+  ASSERT_TRUE(segments.save(path));
+  ASSERT_TRUE(loads());
+
+  //a node out of the graph
+  patchWord(path, nodesAt + 1, n);
+  ASSERT_FALSE(loads());
+
+  //a segment going on after its end
+  ASSERT_TRUE(segments.save(path));
+  patchWord(path, nodesAt + full * 4 + 1, UINT64_MAX);
+  ASSERT_FALSE(loads());
+
+  //offsets not increasing, or with more than perNode segments for a node
+  ASSERT_TRUE(segments.save(path));
+  patchWord(path, offsetsAt + 1, 5);
+  ASSERT_FALSE(loads());
+
+  //nodes not matching the offsets, the count is checked before allocating them
+  ASSERT_TRUE(segments.save(path));
+  patchWord(path, 6, UINT64_MAX / 2);
+  ASSERT_FALSE(loads());
+
+  //truncated
+  ASSERT_TRUE(segments.save(path));
+  {
+    ofstream truncated(path, ios::binary | ios::trunc);
+    uint64_t header[] = {0x31474553525050ULL, fingerprint(dense), n, 4, 2, 0, segments.nodes.size()};
+    truncated.write(reinterpret_cast<const char*>(header), sizeof(header));
+  }
+  ASSERT_FALSE(loads());
+  remove(path);
+}
+
+TEST(walkSegments, reader)
+{
+  unordered_map<int, vector<int>> graph;
+  graph[0] = {1};
+  graph[1] = {0};
+  auto dense = makeDenseGraph(graph);
+  walkSegments segments = buildSegments(dense, 3, 2, 0, 1);
+  vector<size_t> used(dense.size(), 0);
+  {
+    segmentReader reader(segments, used);
+    ASSERT_EQ(reader.length(), 3);
+    //each segment once
+    ASSERT_EQ(reader.take(0), segments.segment(0, 0));
+    ASSERT_EQ(reader.take(0), segments.segment(0, 1));
+    ASSERT_EQ(reader.take(0), nullptr);
+    ASSERT_EQ(reader.take(1), segments.segment(1, 0));
+    ASSERT_EQ(reader.splicedSegments(), 3);
+
+    reader.reset();
+    ASSERT_EQ(used, vector<size_t>(dense.size(), 0));
+    ASSERT_EQ(reader.take(0), segments.segment(0, 0));
+  }
+  //the destructor resets too
+  ASSERT_EQ(used, vector<size_t>(dense.size(), 0));
+}
@@ -0,0 +1,147 @@
+#include <unordered_map>
+#include <vector>
+#include <stdlib.h>//exit
+#include <random>
+
+#include <gtest.h>
+#include <gtest-spi.h>
+#include <mcIncremental.h>
+#include <pprSingleSource.h>
+
+using namespace std;
+using ppr::mcIncremental;
+using ppr::pprInternal::pprSingleSource;
+
+extern random_device rd;
+extern default_random_engine eng;
+extern uniform_int_distribution<unsigned long long> dis;
+
+//scores of every source close to pagerank (mc scores are expected visits,
+//pagerank has the (1 - damping) factor)
+static void assertCloseToPagerank(const mcIncremental<int>& mc, unordered_map<int, vector<int>>& graph)
+{
+  for(const auto& keyVal: graph)
+  {
+    auto res = mc.scores(keyVal.first, 10);
+    auto pagerank = pprSingleSource(graph, 100, 0.85, 0.0001, keyVal.first);
+    for(const auto& score: res)
+      ASSERT_NEAR(score.second * 0.15, pagerank[score.first], 0.05);
+  }
+}
+
+TEST(mcIncremental, badParameters)
+{
+  unordered_map<int, vector<int>> graph;
+  ASSERT_EXIT(mcIncremental<int>(graph, 0, 0.85, 1), ::testing::ExitedWithCode(EXIT_FAILURE), "walks must be positive");
+  ASSERT_EXIT(mcIncremental<int>(graph, 10, 1, 1), ::testing::ExitedWithCode(EXIT_FAILURE), "damping must be \\[0,1)");
+  ASSERT_EXIT(mcIncremental<int>(graph, 10, -0.5, 1), ::testing::ExitedWithCode(EXIT_FAILURE), "damping must be \\[0,1)");
+}
+
+TEST(mcIncremental, singleEdge)
+{
+  unordered_map<int, vector<int>> graph;
+  graph[0];
+  graph[1];
+  mcIncremental<int> mc(graph, 1000, 0.85, 1);
+  ASSERT_EQ(mc.scores(0, 10), (unordered_map<int, double>{{0, 1.0}}));
+
+  //walks stuck in 0 go on with probability 0.85
+  mc.insertEdge(0, 1);
+  auto res = mc.scores(0, 10);
+  ASSERT_EQ(res[0], 1.0);
+  ASSERT_NEAR(res[1], 0.85, 0.05);
+
+  //and stop again once the edge is gone
+  ASSERT_TRUE(mc.removeEdge(0, 1));
+  ASSERT_FALSE(mc.removeEdge(0, 1));
+  ASSERT_FALSE(mc.removeEdge(0, 42));
+  ASSERT_EQ(mc.scores(0, 10), (unordered_map<int, double>{{0, 1.0}}));
+
+  //new nodes are added with their walks
+  mc.insertEdge(2, 0);
+  res = mc.scores(2, 10);
+  ASSERT_EQ(res.size(), 2);
+  ASSERT_NEAR(res[0], 0.85, 0.05);
+  ASSERT_EQ(mc.scores(0, 10).size(), 1);
+  ASSERT_TRUE(mc.scores(3, 10).empty());
+}
+
+TEST(mcIncremental, closeToPagerank)
+{
+  unordered_map<int, vector<int>> graph;
+  for(int i = 0; i < 100; i++)
+    graph[i];
+  for(int i = 0; i < 400; i++)
+    graph[dis(eng)%100].push_back(dis(eng)%100);
+
+  mcIncremental<int> mc(graph, 2000, 0.85, 3);
+  assertCloseToPagerank(mc, graph);
+
+  //random insertions and deletions, results follow the graph
+  for(int update = 0; update < 200; update++)
+  {
+    int u = dis(eng) % 100;
+    if(dis(eng) % 2 == 0 && !graph[u].empty())
+    {
+      int v = graph[u][dis(eng) % graph[u].size()];
+      graph[u].erase(find(graph[u].begin(), graph[u].end(), v));
+      ASSERT_TRUE(mc.removeEdge(u, v));
+    }
+    else
+    {
+      int v = dis(eng) % 100;
+      graph[u].push_back(v);
+      mc.insertEdge(u, v);
+    }
+  }
+  assertCloseToPagerank(mc, graph);
+  ASSERT_GT(mc.reroutedWalks(), 0);
+}
+
+TEST(mcIncremental, localUpdates)
+{
+  //walks of a chain never get to a separate component, so updates there
+  //don't reroute anything
+  unordered_map<int, vector<int>> graph;
+  for(int i = 0; i < 10; i++)
+    graph[i].push_back(i + 1);
+  graph[10];
+  graph[11].push_back(12);
+  graph[12];
+  mcIncremental<int> mc(graph, 100, 0.85, 1);
+  auto before = mc.scores(5);
+
+  mc.insertEdge(12, 11);
+  mc.insertEdge(11, 11);
+  ASSERT_TRUE(mc.removeEdge(11, 12));
+  auto after = mc.scores(5);
+  for(int i = 0; i <= 10; i++)
+    ASSERT_EQ(before[i], after[i]);
+  ASSERT_EQ(mc.scores(11, 5).count(12), 0);
+}
+
+TEST(mcIncremental, storedVisitsBounded)
+{
+  //updates at the head of a chain reroute walks out of the nodes down the
+  //chain, which are never updated themselves
+  unordered_map<int, vector<int>> graph;
+  for(int i = 0; i < 20; i++)
+    graph[i].push_back(i + 1);
+  graph[20].push_back(0);
+  graph[21].push_back(0);
+  mcIncremental<int> mc(graph, 20, 0.85, 1);
+
+  for(int cycle = 0; cycle < 500; cycle++)
+  {
+    mc.insertEdge(0, 21);
+    ASSERT_TRUE(mc.removeEdge(0, 21));
+  }
+  ASSERT_GT(mc.reroutedWalks(), 1000);
+
+  //visits of the walks, from the scores of every source
+  double visits = 0;
+  for(const auto& keyVal: mc.scores(graph.size()))
+    for(const auto& score: keyVal.second)
+      visits += score.second * 20;
+  ASSERT_LE(mc.storedVisits(), 2 * visits + 0.5);
+}
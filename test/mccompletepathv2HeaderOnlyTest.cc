@@ -3,6 +3,9 @@
 #include <vector>
 #include <stdlib.h>//exit
 #include <random>
+#include <queue>
+#include <tuple>
+#include <algorithm>
 
 #include <gtest.h>
 #include <gtest-spi.h>
@@ -17,6 +20,48 @@ extern random_device rd;
 extern default_random_engine eng;
 extern uniform_int_distribution<unsigned long long> dis;
 
+//degree based order as originally written, with a stable sort so that ties
+//keep the iteration order of the graph
+static vector<int> referenceOrder(const unordered_map<int, vector<int>>& graph)
+{
+  unordered_map<int, vector<int>> predecessors;
+  for(const auto& keyVal: graph)
+  {
+    predecessors[keyVal.first];
+    for(int v: keyVal.second)
+      predecessors[v].push_back(keyVal.first);
+  }
+  vector<tuple<int, size_t, size_t>> data;
+  for(const auto& keyVal: graph)
+    data.push_back(make_tuple(keyVal.first, predecessors[keyVal.first].size(), keyVal.second.size()));
+  stable_sort(data.begin(), data.end(),
+    [](const tuple<int, size_t, size_t>& t1, const tuple<int, size_t, size_t>& t2)
+    { return get<1>(t1) > get<1>(t2) || (get<1>(t1) == get<1>(t2) && get<2>(t1) < get<2>(t2));});
+
+  vector<int> order;
+  unordered_map<int, size_t> waitFor;
+  for(const auto& keyVal: graph)
+    waitFor[keyVal.first] = keyVal.second.size();
+  unordered_set<int> visited;
+  for(const auto& t: data)
+  {
+    if(visited.count(get<0>(t)))
+      continue;
+    queue<int> qu;
+    qu.push(get<0>(t));
+    while(!qu.empty())
+    {
+      int next = qu.front(); qu.pop();
+      order.push_back(next);
+      visited.insert(next);
+      for(int pred: predecessors[next])
+        if(waitFor[pred]-- > 0 && !waitFor[pred] && !visited.count(pred))
+          qu.push(pred);
+    }
+  }
+  return order;
+}
+
 TEST(mccompletepathv2HeaderOnly, badParameters)
 {
   unordered_map<int, vector<int>> graph;
@@ -316,3 +361,16 @@ TEST(mccompletepathv2HeaderOnly, testNodesLowerThanK)
       }
   }
 }
+
+TEST(mccompletepathv2HeaderOnly, executionOrder)
+{
+  for(int run = 0; run < 5; run++)
+  {
+    unordered_map<int, vector<int>> graph;
+    for(int i = 0; i < 300; i++)
+      graph[i];
+    for(int i = 0; i < 300 * run; i++)
+      graph[dis(eng)%300].push_back(dis(eng)%300);
+    ASSERT_EQ(ppr::mccompletepathv2Internal::executionOrder(graph), referenceOrder(graph));
+  }
+}
@@ -1,8 +1,10 @@
-#include <unordered_set>
 #include <unordered_map>
 #include <vector>
 #include <stdlib.h>//exit
 #include <random>
+#include <algorithm>
+#include <cstdio>//remove
+#include <fstream>
 
 #include <gtest.h>
 #include <gtest-spi.h>
@@ -11,6 +13,8 @@
 
 using namespace std;
 using ppr::mccompletepathv2;
+using ppr::mccompletepathv2Multi;
+using ppr::runBudget;
 using ppr::pprInternal::pprSingleSource;
 
 extern random_device rd;
@@ -316,3 +320,555 @@ TEST(mccompletepathv2, testNodesLowerThanK)
       }
   }
 }
+
+TEST(mccompletepathv2MultiThread, badParameters)
+{
+  unordered_map<int, vector<int>> graph;
+  ASSERT_EXIT(mccompletepathv2Multi(graph, 0, 3, 42, 0.5, 4), ::testing::ExitedWithCode(EXIT_FAILURE), "K must be positive");
+  ASSERT_EXIT(mccompletepathv2Multi(graph, 2, 0, 32, 0.85, 4), ::testing::ExitedWithCode(EXIT_FAILURE), "L must be positive");
+  ASSERT_EXIT(mccompletepathv2Multi(graph, 2, 1, 10, 0.5, 4), ::testing::ExitedWithCode(EXIT_FAILURE), "K must be <= L");
+  ASSERT_EXIT(mccompletepathv2Multi(graph, 2, 2, 0, 0.5, 4), ::testing::ExitedWithCode(EXIT_FAILURE), "iterations must be positive");
+  ASSERT_EXIT(mccompletepathv2Multi(graph, 2, 2, 10, 1.5, 4), ::testing::ExitedWithCode(EXIT_FAILURE), "damping must be \\[0,1]");
+  ASSERT_EXIT(mccompletepathv2Multi(graph, 2, 2, 10, 0.5, 0), ::testing::ExitedWithCode(EXIT_FAILURE), "nThreads must be positive");
+}
+
+TEST(mccompletepathv2MultiThread, emptyGraph)
+{
+  unordered_map<int, vector<int>> graph;
+  auto res =  mccompletepathv2Multi(graph, 10, 30, 100, 0.85, 4);
+  ASSERT_EQ(res.size(), 0);
+}
+
+TEST(mccompletepathv2MultiThread, testNoEdges)
+{
+  unordered_map<int, vector<int>> graph;
+  for(int i = 0; i < 10; i++)
+    graph[i];
+  auto res =  mccompletepathv2Multi(graph, 10, 30, 100, 0.85, 4);
+  ASSERT_EQ(res.size(), graph.size());
+  for(int i = 0; i < 10; i++)
+  {
+    ASSERT_EQ(res[i].size(), 1);
+    ASSERT_NEAR(res[i][i], 1.0, 10e-5);
+  }
+}
+
+TEST(mccompletepathv2MultiThread, starGraph)
+{
+  unordered_map<int, vector<int>> graph;
+  for(int i = 0; i < 6; i++)
+    graph[i];
+
+  for(int i = 1; i < 6; i++)
+    graph[i].push_back(0);
+
+  auto res =  mccompletepathv2Multi(graph, 10, 30, 100, 0.85, 4);
+  ASSERT_EQ(res.size(), graph.size());
+  ASSERT_EQ(res[0].size(), 1);
+  ASSERT_NEAR(res[0][0], 1.0, 10e-5);
+
+  for(int i = 1; i < 6; i++)
+  {
+    ASSERT_EQ(res[i].size(), 2);
+    ASSERT_NEAR(res[i][0], 0.85, 10e-5);
+  }
+
+  //connect the center to itself
+  graph[0].push_back(0);
+  res =  mccompletepathv2Multi(graph, 10, 30, 1000, 0.85, 4);
+  for(int i = 1; i < 6; i++)
+  {
+    ASSERT_EQ(res[i].size(), 2);
+    ASSERT_GE(res[i][0], 1.0);
+  }
+}
+
+TEST(mccompletepathv2MultiThread, lineGraph)
+{
+  unordered_map<int, vector<int>> graph;
+  for(int i = 0; i < 6; i++)
+    graph[i].push_back((i+1)%6);
+
+  auto res =  mccompletepathv2Multi(graph, 6, 6, 1000, 0.85, 4);
+  ASSERT_EQ(res.size(), graph.size());
+
+  //for each node check that the PPR of a node after is always lower
+  for(int i = 0; i < 6; i++)
+  {
+      ASSERT_EQ(res[i].size(), graph.size());
+      for(int u = 0; u < 5; u++)
+        ASSERT_GE(res[i][(i + u)%6], res[i][(i + u + 1)%6]);
+  }
+}
+
+TEST(mccompletepathv2MultiThread, closeToSequential)
+{
+  unordered_map<int, vector<int>> graph;
+  for(int i = 0; i < 100; i++)
+    graph[i];
+  for(int i = 0; i < 400; i++)
+    graph[dis(eng)%100].push_back(dis(eng)%100);
+
+  //no truncation at all, so that both converge to the expected visits
+  auto seq = mccompletepathv2(graph, 100, 100, 20000, 0.85);
+  for(size_t threads: {1, 3, 8})
+  {
+    auto res = mccompletepathv2Multi(graph, 100, 100, 20000, 0.85, threads);
+    ASSERT_EQ(res.size(), seq.size());
+    for(int i = 0; i < 100; i++)
+      for(const auto& keyVal: seq[i])
+        ASSERT_NEAR(keyVal.second, res[i][keyVal.first], 0.1);
+  }
+}
+
+TEST(mccompletepathv2MultiThread, closeToPagerank)
+{
+  unordered_map<int, vector<int>> graph;
+  for(int i = 0; i < 200; i++)
+    graph[i];
+  for(int i = 0; i < 1000; i++)
+    graph[dis(eng)%200].push_back(dis(eng)%200);
+
+  auto res = mccompletepathv2Multi(graph, 5, 50, 5000, 0.85, 4);
+  ASSERT_EQ(res.size(), graph.size());
+  for(int i = 0; i < 200; i++)
+  {
+    ASSERT_LE(res[i].size(), 5);
+    if(graph[i].empty())
+      continue;
+    //mc scores are expected visits, pagerank has the (1 - damping) factor
+    auto pagerank = pprSingleSource(graph, 100, 0.85, 0.0001, i);
+    for(const auto& keyVal: res[i])
+      ASSERT_NEAR(keyVal.second * 0.15, pagerank[keyVal.first], 0.05);
+  }
+}
+
+TEST(mccompletepathv2, sameSeedSameResults)
+{
+  unordered_map<int, vector<int>> graph;
+  for(int i = 0; i < 100; i++)
+    graph[i];
+  for(int i = 0; i < 500; i++)
+    graph[dis(eng)%100].push_back(dis(eng)%100);
+
+  auto r1 = mccompletepathv2(graph, 10, 20, 500, 0.85, 42);
+  auto r2 = mccompletepathv2(graph, 10, 20, 500, 0.85, 42);
+  ASSERT_EQ(r1, r2);
+}
+
+TEST(mccompletepathv2MultiThread, sameSeedSameResults)
+{
+  unordered_map<int, vector<int>> graph;
+  for(int i = 0; i < 100; i++)
+    graph[i];
+  for(int i = 0; i < 500; i++)
+    graph[dis(eng)%100].push_back(dis(eng)%100);
+
+  //results do not depend on the number of threads
+  auto r1 = mccompletepathv2Multi(graph, 10, 20, 500, 0.85, 1, 42);
+  for(size_t threads: {1, 2, 4, 8})
+  {
+    auto r2 = mccompletepathv2Multi(graph, 10, 20, 500, 0.85, threads, 42);
+    ASSERT_EQ(r1, r2);
+  }
+}
+
+TEST(mccompletepathv2, walkNodeRoundRobin)
+{
+  //0 -> {1, 2, 3} and no other edges, every walk visits exactly one
+  //successor of 0, picked round robin
+  unordered_map<int, vector<int>> graph;
+  graph[0] = {1, 2, 3};
+  graph[1]; graph[2]; graph[3];
+  auto dense = ppr::pprInternal::makeDenseGraph(graph);
+  size_t source = dense.ids[0];
+
+  vector<size_t> index(dense.size(), 0);
+  vector<size_t> slots(dense.size(), ppr::pprInternal::noSlot);
+  vector<size_t> touched;
+  ppr::pprInternal::xoshiro256 generator(1);
+  auto res = ppr::pprInternal::walkNode(dense, index, slots, source, 10, 0.5, 300, generator, &touched, nullptr);
+  ASSERT_EQ(res.size(), 4);
+  ASSERT_NEAR(res[source], 1.0, 10e-9);
+  for(int i = 1; i < 4; i++)
+    ASSERT_NEAR(res[dense.ids[i]], 50.0 / 300, 10e-9);
+
+  //150 walks over 3 successors, the index is back to where it started
+  ASSERT_EQ(index[source], 0);
+  ASSERT_EQ(touched.size(), 50);
+  for(size_t node: touched)
+    ASSERT_EQ(node, source);
+}
+
+TEST(mccompletepathv2, walkFromLanes)
+{
+  //on a cycle a walk only depends on its length, so walking in lock-step
+  //gives the same visits of walking one walk at a time
+  unordered_map<int, vector<int>> cycle;
+  for(int i = 0; i < 50; i++)
+    cycle[i].push_back((i + 1) % 50);
+  auto dense = ppr::pprInternal::makeDenseGraph(cycle);
+  size_t source = dense.ids[0];
+  vector<size_t> index(dense.size(), 0);
+  vector<size_t> slots(dense.size(), ppr::pprInternal::noSlot);
+
+  vector<unordered_map<size_t, double>> visits;
+  vector<size_t> selfVisits;
+  for(size_t lanes: {1, 3, 16})
+  {
+    ppr::pprInternal::xoshiro256 generator(9);
+    ppr::pprInternal::walkLength lengths(generator, 0.85);
+    ppr::pprInternal::spaceSaving counter(dense.size(), slots);
+    size_t self = 0;
+    ppr::pprInternal::walkFrom(dense, index, source, 1000, lengths, counter, self, nullptr, nullptr, lanes);
+    auto entries = counter.entries();
+    visits.push_back(unordered_map<size_t, double>(entries.begin(), entries.end()));
+    selfVisits.push_back(self);
+  }
+  ASSERT_GT(visits[0].size(), 10);
+  for(size_t i = 1; i < visits.size(); i++)
+  {
+    ASSERT_EQ(visits[i], visits[0]);
+    ASSERT_EQ(selfVisits[i], selfVisits[0]);
+  }
+
+  //on a random graph the visits are close
+  unordered_map<int, vector<int>> graph;
+  for(int i = 0; i < 100; i++)
+    graph[i].push_back((i + 1) % 100);
+  for(int i = 0; i < 400; i++)
+    graph[dis(eng)%100].push_back(dis(eng)%100);
+  dense = ppr::pprInternal::makeDenseGraph(graph);
+  source = dense.ids[0];
+  index.assign(dense.size(), 0);
+  slots.assign(dense.size(), ppr::pprInternal::noSlot);
+  ppr::pprInternal::xoshiro256 generator(9);
+  auto batched = ppr::pprInternal::walkNode(dense, index, slots, source, 100, 0.85, 50000, generator, nullptr, nullptr);
+  index.assign(dense.size(), 0);
+  vector<double> batchedScores(dense.size(), 0), serialScores(dense.size(), 0);
+  for(const auto& keyVal: batched)
+    batchedScores[keyVal.first] = keyVal.second;
+  {
+    ppr::pprInternal::walkLength lengths(generator, 0.85);
+    ppr::pprInternal::spaceSaving counter(dense.size(), slots);
+    size_t self = 0;
+    size_t walks = 50000 * 0.85;
+    ppr::pprInternal::walkFrom(dense, index, source, walks, lengths, counter, self, nullptr, nullptr, 1);
+    for(const auto& entry: counter.entries())
+      serialScores[entry.first] = entry.second / 50000;
+    serialScores[source] = (50000.0 + self) / 50000;
+  }
+  for(size_t u = 0; u < dense.size(); u++)
+    ASSERT_NEAR(batchedScores[u], serialScores[u], 0.02);
+}
+
+TEST(mccompletepathv2, walkNodeKeepsHeavyNodes)
+{
+  //0 -> {1, ..., 100}, with 100 looping on itself and getting most of the
+  //visits, even if it is the last successor to be reached
+  unordered_map<int, vector<int>> graph;
+  for(int i = 1; i <= 100; i++)
+  {
+    graph[0].push_back(i);
+    graph[i];
+  }
+  graph[100].push_back(100);
+  auto dense = ppr::pprInternal::makeDenseGraph(graph);
+  size_t source = dense.ids[0];
+  size_t heavy = dense.ids[100];
+
+  vector<size_t> index(dense.size(), 0);
+  vector<size_t> slots(dense.size(), ppr::pprInternal::noSlot);
+  ppr::pprInternal::xoshiro256 generator(3);
+  auto res = ppr::pprInternal::walkNode(dense, index, slots, source, 6, 0.9, 20000, generator, nullptr, nullptr);
+  ASSERT_LE(res.size(), 6);
+  ASSERT_TRUE(res.find(heavy) != res.end());
+  for(const auto& keyVal: res)
+  {
+    if(keyVal.first != source && keyVal.first != heavy)
+    {
+      ASSERT_LT(keyVal.second, res[heavy]);
+    }
+  }
+  //slots are left as they were found
+  ASSERT_EQ(count(slots.begin(), slots.end(), ppr::pprInternal::noSlot), dense.size());
+}
+
+TEST(mccompletepathv2, sccExecutionOrder)
+{
+  unordered_map<int, vector<int>> graph;
+  for(int i = 0; i < 500; i++)
+    graph[i];
+  for(int i = 0; i < 1000; i++)
+    graph[dis(eng)%500].push_back(dis(eng)%500);
+  auto dense = ppr::pprInternal::makeDenseGraph(graph);
+  auto predecessors = ppr::pprInternal::transpose(dense.successors);
+  size_t walked, components;
+  vector<size_t> order = ppr::pprInternal::sccExecutionOrder(dense.successors, predecessors,
+    &walked, &components);
+
+  //a permutation of the nodes
+  ASSERT_EQ(order.size(), dense.size());
+  vector<size_t> position(dense.size(), SIZE_MAX);
+  for(size_t i = 0; i < order.size(); i++)
+  {
+    ASSERT_EQ(position[order[i]], SIZE_MAX);
+    position[order[i]] = i;
+  }
+
+  //the nodes coming after one of their predecessors are the ones which walk
+  size_t late = 0;
+  for(size_t s = 0; s < dense.size(); s++)
+  {
+    bool isLate = false;
+    for(const size_t* it = predecessors.begin(s); it != predecessors.end(s); it++)
+      isLate = isLate || position[*it] <= position[s];
+    late += isLate;
+  }
+  ASSERT_LE(late, walked);
+
+  vector<size_t> component;
+  ASSERT_EQ(ppr::pprInternal::stronglyConnectedComponents(dense.successors, component), components);
+  ppr::mcStats stats;
+  mccompletepathv2(graph, 10, 20, 100, 0.85, 1, nullptr, &stats);
+  ASSERT_EQ(stats.components, components);
+  ASSERT_LE(stats.walkedNodes, walked);
+}
+
+TEST(mccompletepathv2, walkedNodes)
+{
+  ppr::mcStats stats;
+
+  //no cycles, no walks
+  unordered_map<int, vector<int>> dag;
+  for(int i = 0; i < 100; i++)
+    for(int j = i + 1; j < 100; j += 7)
+      dag[i].push_back(j);
+  dag[99];
+  mccompletepathv2(dag, 5, 10, 100, 0.85, 1, nullptr, &stats);
+  ASSERT_EQ(stats.walkedNodes, 0);
+  ASSERT_EQ(stats.components, 100);
+
+  //a single cycle is broken by a single walk
+  unordered_map<int, vector<int>> cycle;
+  for(int i = 0; i < 100; i++)
+    cycle[i].push_back((i + 1) % 100);
+  mccompletepathv2(cycle, 5, 10, 100, 0.85, 1, nullptr, &stats);
+  ASSERT_EQ(stats.walkedNodes, 1);
+  ASSERT_EQ(stats.components, 1);
+
+  //two cycles sharing a node, walking it breaks both
+  unordered_map<int, vector<int>> eight;
+  for(int i = 0; i < 10; i++)
+    eight[i].push_back((i + 1) % 10);
+  for(int i = 10; i < 20; i++)
+    eight[i].push_back((i + 1 < 20)? i + 1 : 0);
+  eight[0].push_back(10);
+  mccompletepathv2(eight, 5, 10, 100, 0.85, 1, nullptr, &stats);
+  ASSERT_EQ(stats.walkedNodes, 1);
+
+  ppr::mcStats multiStats;
+  mccompletepathv2Multi(eight, 5, 10, 100, 0.85, 2, 1, &multiStats);
+  ASSERT_EQ(multiStats.walkedNodes, stats.walkedNodes);
+  ASSERT_EQ(multiStats.walks, stats.walks);
+  ASSERT_EQ(multiStats.components, stats.components);
+}
+
+TEST(mccompletepathv2Segments, closeToPagerank)
+{
+  unordered_map<int, vector<int>> graph;
+  for(int i = 0; i < 200; i++)
+    graph[i];
+  for(int i = 0; i < 1000; i++)
+    graph[dis(eng)%200].push_back(dis(eng)%200);
+
+  ppr::mcSegments segments;
+  ppr::mcStats stats;
+  auto res = mccompletepathv2(graph, 5, 50, 5000, 0.85, 7, nullptr, &stats, &segments);
+  ASSERT_GT(stats.splicedSegments, 0);
+  for(int i = 0; i < 200; i++)
+  {
+    ASSERT_LE(res[i].size(), 5);
+    if(graph[i].empty())
+      continue;
+    auto pagerank = pprSingleSource(graph, 100, 0.85, 0.0001, i);
+    for(const auto& keyVal: res[i])
+      ASSERT_NEAR(keyVal.second * 0.15, pagerank[keyVal.first], 0.05);
+  }
+}
+
+TEST(mccompletepathv2Segments, reusedFromFile)
+{
+  unordered_map<int, vector<int>> graph;
+  for(int i = 0; i < 100; i++)
+    graph[i].push_back((i + 1) % 100);
+  for(int i = 0; i < 300; i++)
+    graph[dis(eng)%100].push_back(dis(eng)%100);
+
+  ppr::mcSegments segments;
+  segments.path = "mccompletepathv2SegmentsTest.bin";
+  segments.memoryCap = 1 << 12;
+  remove(segments.path.c_str());
+
+  //built and saved, then loaded: same segments, same results
+  auto r1 = mccompletepathv2(graph, 10, 20, 500, 0.85, 42, nullptr, nullptr, &segments);
+  ifstream saved(segments.path);
+  ASSERT_TRUE(saved.good());
+  auto r2 = mccompletepathv2(graph, 10, 20, 500, 0.85, 42, nullptr, nullptr, &segments);
+  ASSERT_EQ(r1, r2);
+  remove(segments.path.c_str());
+
+  segments.length = 0;
+  ASSERT_EXIT(mccompletepathv2(graph, 10, 20, 500, 0.85, 42, nullptr, nullptr, &segments),
+    ::testing::ExitedWithCode(EXIT_FAILURE), "segments length must be positive");
+}
+
+TEST(mccompletepathv2Adaptive, sameAsFixedWithoutAdaptive)
+{
+  unordered_map<int, vector<int>> graph;
+  for(int i = 0; i < 100; i++)
+    graph[i];
+  for(int i = 0; i < 500; i++)
+    graph[dis(eng)%100].push_back(dis(eng)%100);
+
+  ppr::mcStats stats;
+  auto r1 = mccompletepathv2(graph, 10, 20, 500, 0.85, 42);
+  auto r2 = mccompletepathv2(graph, 10, 20, 500, 0.85, 42, nullptr, &stats);
+  ASSERT_EQ(r1, r2);
+  ASSERT_EQ(stats.walks, stats.walkedNodes * 500);
+  ASSERT_EQ(stats.stoppedEarly, 0);
+}
+
+TEST(mccompletepathv2Adaptive, stopsEarly)
+{
+  //a long cycle with a few chords, the top-K of every node is easy to find
+  unordered_map<int, vector<int>> graph;
+  for(int i = 0; i < 200; i++)
+    graph[i].push_back((i + 1) % 200);
+  for(int i = 0; i < 200; i += 10)
+    graph[i].push_back((i + 7) % 200);
+
+  ppr::mcAdaptive adaptive;
+  ppr::mcStats fixedStats;
+  ppr::mcStats adaptiveStats;
+  mccompletepathv2(graph, 5, 10, 10000, 0.85, 1, nullptr, &fixedStats);
+  auto res = mccompletepathv2(graph, 5, 10, 10000, 0.85, 1, &adaptive, &adaptiveStats);
+
+  ASSERT_EQ(adaptiveStats.walkedNodes, fixedStats.walkedNodes);
+  ASSERT_GT(adaptiveStats.stoppedEarly, 0);
+  ASSERT_LT(adaptiveStats.walks, fixedStats.walks / 2);
+
+  //the node itself and the next ones on the cycle are still the top
+  for(int i = 0; i < 200; i++)
+  {
+    ASSERT_EQ(res[i].size(), 5);
+    ASSERT_GE(res[i][i], res[i][(i + 1) % 200]);
+    ASSERT_GE(res[i][(i + 1) % 200], res[i][(i + 2) % 200]);
+  }
+}
+
+TEST(mccompletepathv2Adaptive, walkBudget)
+{
+  unordered_map<int, vector<int>> graph;
+  for(int i = 0; i < 100; i++)
+    graph[i];
+  for(int i = 0; i < 500; i++)
+    graph[dis(eng)%100].push_back(dis(eng)%100);
+
+  ppr::mcAdaptive adaptive;
+  adaptive.roundWalks = 50;
+  adaptive.stableRounds = 1000;
+  adaptive.confidence = 0;
+  adaptive.walkBudget = 2000;
+  ppr::mcStats stats;
+  auto res = mccompletepathv2(graph, 5, 10, 10000, 0.85, 1, &adaptive, &stats);
+  ASSERT_EQ(res.size(), graph.size());
+
+  //once the budget is spent nodes only do their first round
+  ASSERT_GE(stats.walks, 2000);
+  ASSERT_LE(stats.walks, 2000 + stats.walkedNodes * 50);
+  ASSERT_EQ(stats.stoppedEarly, stats.walkedNodes);
+}
+
+TEST(mccompletepathv2Budget, cancelled)
+{
+  unordered_map<int, vector<int>> graph;
+  for(int i = 0; i < 100; i++)
+    graph[i];
+  for(int i = 0; i < 400; i++)
+    graph[dis(eng) % 100].push_back(dis(eng) % 100);
+
+  //no node gets to walk nor to combine, maps are the first step of the walks
+  runBudget cancelled;
+  cancelled.cancel();
+  auto res = mccompletepathv2(graph, 100, 100, 1000, 0.85, 42, nullptr, nullptr, nullptr, &cancelled);
+  auto resMulti = mccompletepathv2Multi(graph, 100, 100, 1000, 0.85, 4, 42, nullptr, &cancelled);
+  ASSERT_TRUE(cancelled.stoppedEarly());
+  ASSERT_EQ(res, resMulti);
+  for(int i = 0; i < 100; i++)
+  {
+    unordered_map<int, double> expected;
+    expected[i] += 1.0;
+    for(int s: graph[i])
+      expected[s] += 0.85 / graph[i].size();
+    ASSERT_EQ(res[i].size(), expected.size());
+    for(const auto& keyVal: expected)
+      ASSERT_NEAR(res[i][keyVal.first], keyVal.second, 10e-9);
+  }
+
+  //a budget which does not expire changes nothing
+  runBudget hour(3600);
+  ASSERT_EQ(mccompletepathv2(graph, 10, 50, 1000, 0.85, 42, nullptr, nullptr, nullptr, &hour),
+    mccompletepathv2(graph, 10, 50, 1000, 0.85, 42));
+  ASSERT_EQ(mccompletepathv2Multi(graph, 10, 50, 1000, 0.85, 4, 42, nullptr, &hour),
+    mccompletepathv2Multi(graph, 10, 50, 1000, 0.85, 4, 42));
+  ASSERT_FALSE(hour.stoppedEarly());
+}
+
+TEST(mccompletepathv2Budget, cancelledStats)
+{
+  unordered_map<int, vector<int>> graph;
+  for(int i = 0; i < 100; i++)
+    graph[i];
+  for(int i = 0; i < 400; i++)
+    graph[dis(eng) % 100].push_back(dis(eng) % 100);
+
+  //cancelled before the start, walks which never ran are not reported
+  for(size_t threads: {1, 4})
+  {
+    runBudget cancelled;
+    cancelled.cancel();
+    ppr::mcStats stats;
+    if(threads == 1)
+      mccompletepathv2(graph, 10, 50, 1000, 0.85, 42, nullptr, &stats, nullptr, &cancelled);
+    else
+      mccompletepathv2Multi(graph, 10, 50, 1000, 0.85, threads, 42, &stats, &cancelled);
+    ASSERT_EQ(stats.walks, 0);
+    ASSERT_EQ(stats.walkedNodes, 0);
+  }
+}
+
+TEST(mccompletepathv2Budget, timeout)
+{
+  unordered_map<int, vector<int>> graph;
+  int n = 20000;
+  for(int i = 0; i < n; i++)
+    graph[i];
+  for(int i = 0; i < 10 * n; i++)
+    graph[dis(eng) % n].push_back(dis(eng) % n);
+
+  //every node gets a map, the ones not done from the walks or the first step
+  for(size_t threads: {1, 4})
+  {
+    runBudget timeout(0.05);
+    auto res = (threads == 1)? mccompletepathv2(graph, 10, 50, 100000, 0.85, 42, nullptr, nullptr, nullptr, &timeout) :
+      mccompletepathv2Multi(graph, 10, 50, 100000, 0.85, threads, 42, nullptr, &timeout);
+    ASSERT_TRUE(timeout.stoppedEarly());
+    ASSERT_EQ(res.size(), n);
+    for(const auto& keyVal: res)
+    {
+      ASSERT_GT(keyVal.second.size(), 0);
+      ASSERT_LE(keyVal.second.size(), 10);
+    }
+  }
+}
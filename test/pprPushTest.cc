@@ -0,0 +1,203 @@
+#include <unordered_map>
+#include <vector>
+#include <stdlib.h>//exit
+#include <random>
+#include <cmath>
+#include <algorithm>//max
+
+#include <gtest.h>
+#include <gtest-spi.h>
+#include <graphGenerators.h>
+#include <pprPush.h>
+#include <pprSingleSource.h>
+
+using namespace std;
+using ppr::backwardPush;
+using ppr::bippr;
+using ppr::erdosRenyiGraph;
+using ppr::forwardPush;
+using ppr::pprInternal::predecessorsOf;
+using ppr::pprInternal::pprSingleSource;
+using ppr::pprInternal::pushForward;
+
+extern random_device rd;
+extern default_random_engine eng;
+extern uniform_int_distribution<unsigned long long> dis;
+
+TEST(forwardPush, badParameters)
+{
+  unordered_map<int, vector<int>> graph;
+  graph[0];
+  ASSERT_EXIT(forwardPush(graph, 0, 0, 0.85, 0.001), ::testing::ExitedWithCode(EXIT_FAILURE), "K must be positive");
+  ASSERT_EXIT(forwardPush(graph, 0, 1, 1.0, 0.001), ::testing::ExitedWithCode(EXIT_FAILURE), "damping must be \\[0,1)");
+  ASSERT_EXIT(forwardPush(graph, 0, 1, -0.5, 0.001), ::testing::ExitedWithCode(EXIT_FAILURE), "damping must be \\[0,1)");
+  ASSERT_EXIT(forwardPush(graph, 0, 1, 0.85, 0.0), ::testing::ExitedWithCode(EXIT_FAILURE), "epsilon must be positive");
+  ASSERT_EXIT(forwardPush(graph, 1, 1, 0.85, 0.001), ::testing::ExitedWithCode(EXIT_FAILURE), "source node not part of the graph");
+}
+
+TEST(forwardPush, singleNode)
+{
+  unordered_map<int, vector<int>> graph;
+  graph[0];
+  auto res = forwardPush(graph, 0, 10, 0.85, 0.001);
+  ASSERT_EQ(res.size(), 1);
+  ASSERT_NEAR(res[0], 0.15, 0.00001);
+}
+
+TEST(forwardPush, closeToPagerank)
+{
+  for(int t = 0; t < 10; t++)
+  {
+    auto graph = erdosRenyiGraph<int>(200, 2.5, dis(eng), 1);
+    for(int source = 0; source < 200; source += 17)
+    {
+      const double epsilon = 1e-4;
+      unordered_map<int, double> estimates, residuals;
+      pushForward(graph, source, 0.85, epsilon, estimates, residuals);
+      auto pagerank = pprSingleSource(graph, 1000, 0.85, 1e-12, source);
+
+      //the residual left at every node is at most epsilon times its outdegree
+      double residual = 0;
+      for(const auto& keyVal: residuals)
+      {
+        ASSERT_LE(keyVal.second, epsilon * max<size_t>(graph[keyVal.first].size(), 1));
+        residual += keyVal.second;
+      }
+      //estimates are never above pagerank, and below it by at most the
+      //residuals left, each and all together
+      double error = 0;
+      for(const auto& keyVal: pagerank)
+      {
+        double estimate = estimates.count(keyVal.first)? estimates[keyVal.first] : 0;
+        ASSERT_LE(estimate, keyVal.second + 1e-9);
+        ASSERT_LE(keyVal.second - estimate, residual + 1e-9);
+        error += keyVal.second - estimate;
+      }
+      ASSERT_LE(error, residual + 1e-9);
+
+      auto res = forwardPush(graph, source, 20, 0.85, epsilon);
+      ASSERT_LE(res.size(), 20);
+      for(const auto& keyVal: res)
+        ASSERT_EQ(keyVal.second, estimates[keyVal.first]);
+    }
+  }
+}
+
+TEST(forwardPush, epsilonBoundsWork)
+{
+  //a big ring: with a large threshold only the nodes close to the source are reached
+  unordered_map<int, vector<int>> graph;
+  for(int i = 0; i < 100000; i++)
+    graph[i].push_back((i + 1) % 100000);
+
+  auto res = forwardPush(graph, 0, 100000, 0.85, 0.01);
+  ASSERT_LT(res.size(), 50);
+  for(int i = 0; i < (int)res.size(); i++)
+    ASSERT_NEAR(res[i], 0.15 * pow(0.85, i), 0.01);
+}
+
+TEST(forwardPush, allSources)
+{
+  auto graph = erdosRenyiGraph<int>(300, 3.5, dis(eng), 1);
+  auto res = forwardPush(graph, 10, 0.85, 1e-5);
+  ASSERT_EQ(res.size(), graph.size());
+  for(const auto& keyVal: res)
+  {
+    ASSERT_LE(keyVal.second.size(), 10);
+    ASSERT_EQ(keyVal.second, forwardPush(graph, keyVal.first, 10, 0.85, 1e-5));
+  }
+}
+
+TEST(backwardPush, badParameters)
+{
+  unordered_map<int, vector<int>> graph;
+  graph[0];
+  ASSERT_EXIT(backwardPush(graph, 0, 0, 0.85, 0.001), ::testing::ExitedWithCode(EXIT_FAILURE), "K must be positive");
+  ASSERT_EXIT(backwardPush(graph, 0, 1, 1.0, 0.001), ::testing::ExitedWithCode(EXIT_FAILURE), "damping must be \\[0,1)");
+  ASSERT_EXIT(backwardPush(graph, 0, 1, 0.85, -1.0), ::testing::ExitedWithCode(EXIT_FAILURE), "epsilon must be positive");
+  ASSERT_EXIT(backwardPush(graph, 1, 1, 0.85, 0.001), ::testing::ExitedWithCode(EXIT_FAILURE), "target node not part of the graph");
+}
+
+TEST(backwardPush, star)
+{
+  //every node points to 0, which points to nothing
+  unordered_map<int, vector<int>> graph;
+  graph[0];
+  for(int i = 1; i < 10; i++)
+    graph[i].push_back(0);
+
+  auto res = backwardPush(graph, 0, 100, 0.85, 1e-6);
+  ASSERT_EQ(res.size(), 10);
+  ASSERT_NEAR(res[0], 0.15, 1e-9);
+  for(int i = 1; i < 10; i++)
+    ASSERT_NEAR(res[i], 0.85 * 0.15, 1e-9);
+
+  res = backwardPush(graph, 0, 3, 0.85, 1e-6);
+  ASSERT_EQ(res.size(), 3);
+  ASSERT_EQ(res.count(0), 1);
+}
+
+TEST(backwardPush, closeToPagerank)
+{
+  for(int t = 0; t < 10; t++)
+  {
+    auto graph = erdosRenyiGraph<int>(200, 2.5, dis(eng), 1);
+    auto predecessors = predecessorsOf(graph);
+    //pagerank of every source, to be read by target
+    unordered_map<int, unordered_map<int, double>> pagerank;
+    for(int source = 0; source < 200; source++)
+      pagerank[source] = pprSingleSource(graph, 1000, 0.85, 1e-9, source);
+
+    for(int target = 0; target < 200; target += 13)
+    {
+      auto res = backwardPush(graph, predecessors, target, 200, 0.85, 1e-5);
+      for(int source = 0; source < 200; source++)
+      {
+        double expected = pagerank[source][target];
+        double estimate = (res.count(source))? res[source] : 0;
+        ASSERT_LE(estimate, expected + 1e-9);
+        ASSERT_GE(estimate, expected - 1e-5);
+      }
+    }
+  }
+}
+
+TEST(bippr, badParameters)
+{
+  unordered_map<int, vector<int>> graph;
+  graph[0];
+  ASSERT_EXIT(bippr(graph, 0, 0, 1.0, 0.001, 10, 1), ::testing::ExitedWithCode(EXIT_FAILURE), "damping must be \\[0,1)");
+  ASSERT_EXIT(bippr(graph, 0, 0, 0.85, 0.0, 10, 1), ::testing::ExitedWithCode(EXIT_FAILURE), "epsilon must be positive");
+  ASSERT_EXIT(bippr(graph, 0, 0, 0.85, 0.001, 0, 1), ::testing::ExitedWithCode(EXIT_FAILURE), "walks must be positive");
+  ASSERT_EXIT(bippr(graph, 1, 0, 0.85, 0.001, 10, 1), ::testing::ExitedWithCode(EXIT_FAILURE), "source node not part of the graph");
+  ASSERT_EXIT(bippr(graph, 0, 1, 0.85, 0.001, 10, 1), ::testing::ExitedWithCode(EXIT_FAILURE), "target node not part of the graph");
+}
+
+TEST(bippr, sameSeedSameEstimate)
+{
+  auto graph = erdosRenyiGraph<int>(300, 2.5, dis(eng), 1);
+  double first = bippr(graph, 1, 2, 0.85, 0.01, 1000, 42);
+  ASSERT_EQ(first, bippr(graph, 1, 2, 0.85, 0.01, 1000, 42));
+}
+
+TEST(bippr, closeToPagerank)
+{
+  for(int t = 0; t < 5; t++)
+  {
+    auto graph = erdosRenyiGraph<int>(300, 2.5, dis(eng), 1);
+    auto predecessors = predecessorsOf(graph);
+    for(int source = 0; source < 300; source += 37)
+    {
+      auto pagerank = pprSingleSource(graph, 1000, 0.85, 1e-9, source);
+      for(int target = 0; target < 300; target += 29)
+      {
+        //coarse push, the walks have to make up for it
+        double estimate = bippr(graph, predecessors, source, target, 0.85, 0.01, 2000, dis(eng));
+        ASSERT_NEAR(estimate, pagerank[target], 0.003);
+        //fine push, the walks add little
+        estimate = bippr(graph, predecessors, source, target, 0.85, 1e-7, 10, dis(eng));
+        ASSERT_NEAR(estimate, pagerank[target], 1e-5);
+      }
+    }
+  }
+}